@@ -27,220 +27,495 @@
 #include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <limits.h>
+
+#include "analyze.h"
+#include "audio.h"
+#include "downscale.h"
+#include "extract.h"
+#include "governor.h"
+#include "motion.h"
+#include "outfile.h"
+#include "passthrough.h"
+#include "playlist.h"
+#include "queue.h"
+#include "seek.h"
+#include "shard.h"
+#include "supervisor.h"
+#include "thumbnail.h"
+#include "tiles.h"
+#include "writer.h"
+#include "yuv.h"
 
 // #include <cairo.h>
 // #include <gtk/gtk.h>
 
-static AVFrame *rgb24_frame = NULL; // use to write raw data source on cairo
-static enum AVPixelFormat src_pix_fmt = AV_PIX_FMT_YUV420P, dst_pix_fmt = AV_PIX_FMT_RGB24;
+#define PACKET_QUEUE_SIZE 64 // demux -> decode
+#define FRAME_QUEUE_SIZE 16  // decode -> writers, bounds the decoded frames held in memory
+#define MAX_WRITERS 64
+#define PIPELINE_END (-2) // stream_index of the empty packet that flushes the decoder at the end of the stream
 
 /**
- * @brief 
- * Function to log messages
- * @param fmt 
- * @param ... 
+ * @brief
+ * A decoded frame on its way to the writer pool
  */
-static void logging(const char *fmt, ...);
+typedef struct FrameJob {
+    AVFrame *frame;
+    int fnumber;
+} FrameJob;
+
+/**
+ * @brief
+ * State shared by the pipeline stages:
+ * demux (main thread) --packets--> decode thread --frames--> writer threads
+ */
+typedef struct Pipeline {
+    const ExtractContext *extract;
+    AVCodecContext *pCodecContext;
+    SpscQueue packets;
+    MpmcQueue frames;
+    atomic_int decode_error;
+    MotionFilter *motion; // -m: only frames with enough motion reach the writers, NULL otherwise
+    int yuv;              // -y/-Y: write the raw decoded planes instead of .pgm/.ppm
+    YuvStream *yuv_stream; // -Y: all frames appended to one .yuv file, NULL for one file per frame
+    Playlist *playlist;   // several inputs on one timeline, NULL for a single input
+} Pipeline;
 
 /**
  * @brief 
  * Function to decode stream packets into frames
- * @param pPacket 
+ * @param pPacket NULL flushes the decoder
  * @param pCodecContext 
  * @param pFrame 
+ * @param frames queue the decoded frames are handed to
+ * @param extract input the packets come from
+ * @param motion frame selection by motion energy, NULL to keep every frame
+ * @param playlist timeline the frames are numbered and timed on, NULL for a single input
  * @return int 
  */
-static int decode_packet(AVPacket *pPacket, AVCodecContext *pCodecContext, AVFrame *pFrame);
+static int decode_packet(AVPacket *pPacket, AVCodecContext *pCodecContext, AVFrame *pFrame, MpmcQueue *frames, const ExtractContext *extract, MotionFilter *motion, Playlist *playlist);
 
 /**
- * @brief 
- * Function to convert frame into grayscale and save
- * @param buf 
- * @param wrap 
- * @param xsize 
- * @param ysize 
- * @param filename 
+ * @brief
+ * Decode stage: pops packets queued by main() and pushes the decoded frames to the writers
+ * @param arg Pipeline
+ * @return void*
  */
-static void save_gray_frame(unsigned char *buf, int wrap, int xsize, int ysize, int fnumber);
+static void *decode_thread(void *arg);
 
 /**
- * @brief 
- * Function to convert frame into grayscale and save
- * @param buf 
- * @param wrap 
- * @param xsize 
- * @param ysize 
- * @param filename 
+ * @brief
+ * Writer stage: pops decoded frames and saves them as .pgm and .ppm (or .qoi), or as raw .yuv
+ * @param arg Pipeline
+ * @return void*
  */
-// static void save_rgb_frame(unsigned char *buf, uint8_t const * const * data, int lsize, enum AVPixelFormat pix_fmt, int wrap, int xsize, int ysize, char *filename);
-static void save_rgb_frame(AVFrame *frame, int fnumber);
+static void *writer_thread(void *arg);
 
+/**
+ * @brief
+ * Save the frames displayed at the given times instead of running the pipeline
+ * @param extract opened input
+ * @param times comma separated list of seconds, e.g. "73.4,12,12.04"
+ * @return int 0 on success, -1 if a frame could not be extracted
+ */
+static int extract_at_times(ExtractContext *extract, char *times);
 
+/**
+ * @brief
+ * Decode the whole stream and save only the best frame of every window, by
+ * sharpness and exposure (thumbnail.c)
+ * @param extract opened input
+ * @param window window length in seconds
+ * @return int 0 on success, -1 on failure
+ */
+static int extract_best_thumbnails(ExtractContext *extract, double window);
 
-static AVFrame* allocateFrame(int width, int height);
+/**
+ * @brief
+ * Write the selected packets of an intra-only image stream (MJPEG, PNG, ...)
+ * straight to image files, without decoding them
+ * @param extract input opened with extract_open_input()
+ * @param codec_id codec of the video stream
+ * @return int 0 on success, -1 on failure
+ */
+static int extract_passthrough(ExtractContext *extract, enum AVCodecID codec_id);
 
 int main(int argc, char **argv){
 
+    long nb_writers = sysconf(_SC_NPROCESSORS_ONLN); // one writer per core unless -j says otherwise
+    char *times = NULL; // -t: exact-timestamp lookup instead of the pipeline
+    int analyze = 0;    // -a: decode-free JSON report instead of the pipeline
+    int force_decode = 0; // -D: decode even when the packets could be written as they are
+    int analyze_audio = 0; // -A: loudness and waveform of the audio stream, in the same demux pass
+    double best_window = 0; // -b: best thumbnail per window of that many seconds
+    double motion_threshold = -1; // -m: keep the frames whose motion energy reaches it
+    int shard_index = -1, shard_count = 0; // --shard i/N: this process' part of the input
+    const char *merge_output = NULL; // --merge out: stitch shard manifests instead of extracting
+    const char *queue = NULL; // --queue dir: supervise worker processes draining an on-disk job queue
+    long nb_worker_processes = sysconf(_SC_NPROCESSORS_ONLN), max_retries = 2;
+    const char *governor_file = NULL; // --governor file: limits re-read while a --queue batch runs
+    RgbFormat rgb_format = RGB_FORMAT_PPM; // -f: file format of the RGB images
+    int gray_factor = 1; // -s: the .pgm images reduced that many times
+    TileLayout tile_layout = TILE_LAYOUT_NONE; // --tiles: deep zoom pyramids instead of RGB images
+    WriteMode write_mode = WRITE_MODE_AUTO; // --write-mode: how the image files reach the disk
+    int yuv = 0; // -y: raw planes, one .yuv per frame
+    const char *yuv_path = NULL; // -Y: raw planes of every frame in one file, with an index
+    DecodePreset preset = DECODE_PRESET_EXACT;
+    int opt, option_index;
+
+    static const struct option long_options[] = {
+        { "shard", required_argument, NULL, 'S' },
+        { "merge", required_argument, NULL, 'M' },
+        { "queue", required_argument, NULL, 'Q' },
+        { "workers", required_argument, NULL, 'W' },
+        { "retries", required_argument, NULL, 'R' },
+        { "governor", required_argument, NULL, 'g' },
+        { "tiles", required_argument, NULL, 'T' },
+        { "write-mode", required_argument, NULL, 'O' },
+        // resource limits, named as in governor.h
+        { "threads", required_argument, NULL, 'G' },
+        { "read-limit", required_argument, NULL, 'G' },
+        { "write-limit", required_argument, NULL, 'G' },
+        { "max-fps", required_argument, NULL, 'G' },
+        { "nice", required_argument, NULL, 'G' },
+        { "ioclass", required_argument, NULL, 'G' },
+        { NULL, 0, NULL, 0 },
+    };
+
+    while ((opt = getopt_long(argc, argv, "Aab:Df:j:m:q:s:t:yY:", long_options, &option_index)) != -1) {
+        switch (opt) {
+        case 'A':
+            analyze_audio = 1;
+            break;
+        case 'a':
+            analyze = 1;
+            break;
+        case 'b':
+            best_window = strtod(optarg, NULL);
+            if (best_window <= 0) {
+                printf("the thumbnail window must be a positive number of seconds\n");
+                return -1;
+            }
+            break;
+        case 'D':
+            force_decode = 1;
+            break;
+        case 'f':
+            if (rgb_format_parse(optarg, &rgb_format) < 0) {
+                printf("unknown image format '%s', use ppm or qoi\n", optarg);
+                return -1;
+            }
+            break;
+        case 'j':
+            nb_writers = strtol(optarg, NULL, 10);
+            break;
+        case 'm':
+            motion_threshold = strtod(optarg, NULL);
+            if (motion_threshold < 0) {
+                printf("the motion threshold must not be negative\n");
+                return -1;
+            }
+            break;
+        case 'q':
+            if (decode_preset_parse(optarg, &preset) < 0) {
+                printf("unknown decode preset '%s', use exact, fast or fastest\n", optarg);
+                return -1;
+            }
+            break;
+        case 's':
+            if (downscale_factor_parse(optarg, &gray_factor) < 0) {
+                printf("the gray image can be reduced by 1, 2, 4 or 8\n");
+                return -1;
+            }
+            break;
+        case 't':
+            times = optarg;
+            break;
+        case 'y':
+            yuv = 1;
+            break;
+        case 'Y':
+            yuv = 1;
+            yuv_path = optarg;
+            break;
+        case 'S':
+            if (shard_parse(optarg, &shard_index, &shard_count) < 0) {
+                printf("the shard must be i/N with 0 <= i < N\n");
+                return -1;
+            }
+            break;
+        case 'M':
+            merge_output = optarg;
+            break;
+        case 'Q':
+            queue = optarg;
+            break;
+        case 'W':
+            nb_worker_processes = strtol(optarg, NULL, 10);
+            break;
+        case 'R':
+            max_retries = strtol(optarg, NULL, 10);
+            break;
+        case 'g':
+            governor_file = optarg;
+            break;
+        case 'T':
+            if (tile_layout_parse(optarg, &tile_layout) < 0) {
+                printf("unknown tile layout '%s', use dzi or xyz\n", optarg);
+                return -1;
+            }
+            break;
+        case 'O':
+            if (write_mode_parse(optarg, &write_mode) < 0) {
+                printf("unknown write mode '%s', use auto, buffered, mmap, direct or dontneed\n", optarg);
+                return -1;
+            }
+            outfile_set_mode(write_mode);
+            break;
+        case 'G':
+            if (governor_set(long_options[option_index].name, optarg) < 0) {
+                printf("invalid value '%s' for --%s\n", optarg, long_options[option_index].name);
+                return -1;
+            }
+            break;
+        default:
+            printf("usage: %s [-a] [-A] [-b window_seconds] [-D] [-f ppm|qoi] [-j writer_threads] [-m motion_threshold] [-q exact|fast|fastest] [-s 2|4|8] [-t seconds[,seconds...]] [-y | -Y all.yuv] [--tiles dzi|xyz] [--write-mode auto|buffered|mmap|direct|dontneed] [--shard i/N] media_file...\n"
+                   "       %s --merge merged.manifest shard-*.manifest\n"
+                   "       %s --queue dir [--workers N] [--retries K] [--governor file] [media_file...]\n"
+                   "limits: [--threads N] [--read-limit bytes/s] [--write-limit bytes/s] [--max-fps F] [--nice N] [--ioclass idle|be[:0-7]|rt[:0-7]]\n",
+                   argv[0], argv[0], argv[0]);
+            return -1;
+        }
+    }
+    nb_writers = nb_writers < 1 ? 1 : nb_writers > MAX_WRITERS ? MAX_WRITERS : nb_writers;
+    writer_set_rgb_format(rgb_format);
+    writer_set_gray_factor(gray_factor);
+    writer_set_tile_layout(tile_layout);
+
+    if (merge_output)
+        return shard_merge(merge_output, argv + optind, argc - optind);
+
+    if (queue) {
+        // the limits are shared by all the workers, and adjustable through the governor file while they run
+        if (governor_share() < 0 || (governor_file && governor_watch(governor_file) < 0))
+            return -1;
+        governor_apply_priority();
+        if (supervisor_enqueue(queue, argv + optind, argc - optind) < 0)
+            return -1;
+        return supervisor_run(queue, nb_worker_processes < 1 ? 1 : (int)nb_worker_processes, max_retries < 0 ? 0 : (int)max_retries);
+    }
+
+    if (governor_file && governor_load(governor_file) < 0)
+        return -1;
+    governor_apply_priority(); // before any thread is created, so they all inherit it
+
     // Check to make sure filename is passed to the command line
-    if (argc < 2) {
+    if (optind >= argc) {
         printf("You need to specify a media file.\n");
         return -1; // exit application if no filename is passed
     }
+    const char *input = argv[optind];
 
-    logging("initializing all the containers, codecs and protocols.");
-
-    // AVFormatContext holds the header information from the format (Container) - Allocating memory for this component
-    AVFormatContext *pFormatContext = avformat_alloc_context();
-    if (!pFormatContext) {
-        logging("ERROR could not allocate memory for Format Context");
+    // several inputs: one continuous timeline through the pipeline (playlist.h)
+    int nb_inputs = argc - optind;
+    if (nb_inputs > 1 && (analyze || analyze_audio || times || best_window > 0 || shard_count > 0)) {
+        printf("-a, -A, -b, -t and --shard take a single media file\n");
         return -1;
     }
 
-    // Open the file and read its header. The codecs are not opened.
-    logging("opening the input file (%s) and loading format (container) header", argv[1]);
-    if (avformat_open_input(&pFormatContext, argv[1], NULL, NULL) != 0) {
-        logging("ERROR av could not open the file");
-        return -1; // exit application if av could not be opened
-    }
-
-    // Log some info about file after reading header
-    logging("format %s, duration %lld us, bit_rate %lld", pFormatContext->iformat->name, pFormatContext->duration, pFormatContext->bit_rate);
-    
-    // read Packets from the Format to get stream information, this function populates pFormatContext->streams
-    logging("finding stream info from format");
-    if (avformat_find_stream_info(pFormatContext,  NULL) < 0) {
-        logging("ERROR could not get the stream info");
+    // the loudness series is computed from the packets of the pipeline's demux pass only
+    if (analyze_audio && (analyze || times || best_window > 0 || shard_count > 0)) {
+        printf("-A cannot be combined with -a, -b, -t or --shard\n");
         return -1;
     }
 
-    AVCodec *pCodec = NULL; // the component that knows how to enCOde and DECode the stream
-    AVCodecParameters *pCodecParameters =  NULL;   // this component describes the properties of a codec used by the stream i
-    int video_stream_index = -1;
+    if (analyze)
+        return analyze_stream(input, stdout);
 
-    // loop though all the streams and print its main information
-    for (int i = 0; i < pFormatContext->nb_streams; i++)
-    {
-        AVCodecParameters *pLocalCodecParameters =  NULL;
-        pLocalCodecParameters = pFormatContext->streams[i]->codecpar;
-        logging("AVStream->time_base before open coded %d/%d", pFormatContext->streams[i]->time_base.num, pFormatContext->streams[i]->time_base.den);
-        logging("AVStream->r_frame_rate before open coded %d/%d", pFormatContext->streams[i]->r_frame_rate.num, pFormatContext->streams[i]->r_frame_rate.den);
-        logging("AVStream->start_time %" PRId64, pFormatContext->streams[i]->start_time);
-        logging("AVStream->duration %" PRId64, pFormatContext->streams[i]->duration);
+    ExtractContext extract = { .video_stream_index = -1, .preset = preset, .export_motion_vectors = motion_threshold >= 0 };
+    Playlist playlist;
+    if (nb_inputs > 1 ? playlist_open(&playlist, argv + optind, nb_inputs, &extract) < 0 : extract_open_input(&extract, input) < 0)
+        return -1;
+    ExtractContext *pExtract = nb_inputs > 1 ? playlist_current(&playlist) : &extract;
+
+    // intra-only image codecs: every packet already is an image file
+    enum AVCodecID codec_id = pExtract->pFormatContext->streams[pExtract->video_stream_index]->codecpar->codec_id;
+    if (nb_inputs == 1 && !times && !best_window && motion_threshold < 0 && !analyze_audio && shard_count == 0 && !yuv && gray_factor == 1 && tile_layout == TILE_LAYOUT_NONE && rgb_format == RGB_FORMAT_PPM && !force_decode && passthrough_extension(codec_id)) {
+        int ret = extract_passthrough(&extract, codec_id);
+        extract_close(&extract);
+        return ret;
+    }
 
-        logging("finding the proper decoder (CODEC)");
+    if (nb_inputs == 1 && extract_open_decoder(&extract) < 0)
+        return -1;
 
-        AVCodec *pLocalCodec = NULL;
-        pLocalCodec = avcodec_find_decoder(pLocalCodecParameters->codec_id);   // finds the registered decoder for a codec ID
+    if (times) {
+        int ret = extract_at_times(&extract, times);
+        extract_close(&extract);
+        return ret;
+    }
 
-        if (pLocalCodec==NULL) {
-            logging("ERROR unsupported codec!"); // if the codec is not found, just skip it
-            continue;
-        }
+    if (best_window > 0) {
+        int ret = extract_best_thumbnails(&extract, best_window);
+        extract_close(&extract);
+        return ret;
+    }
 
-        // when the stream is a video we store its index, codec parameters and codec
-        if (pLocalCodecParameters->codec_type == AVMEDIA_TYPE_VIDEO) {
-        if (video_stream_index == -1) {
-            video_stream_index = i;
-            pCodec = pLocalCodec;
-            pCodecParameters = pLocalCodecParameters;
-        }
+    if (shard_count > 0) {
+        int ret = shard_run(&extract, input, shard_index, shard_count);
+        extract_close(&extract);
+        return ret;
+    }
 
-        logging("Video Codec: resolution %d x %d", pLocalCodecParameters->width, pLocalCodecParameters->height);
-        } else if (pLocalCodecParameters->codec_type == AVMEDIA_TYPE_AUDIO) {
-        logging("Audio Codec: %d channels, sample rate %d", pLocalCodecParameters->channels, pLocalCodecParameters->sample_rate);
-        }
+    AVFormatContext *pFormatContext = pExtract->pFormatContext;
+    AVCodecContext *pCodecContext = pExtract->pCodecContext;
+    int video_stream_index = pExtract->video_stream_index;
 
-        // print its name, id and bitrate
-        logging("\tCodec %s ID %d bit_rate %lld", pLocalCodec->name, pLocalCodec->id, pLocalCodecParameters->bit_rate);
-    } 
+    AVPacket *pPacket = pExtract->pPacket;
 
-    // check file to check if contains video stream 
-    if (video_stream_index == -1) {
-        logging("File %s does not contain a video stream!", argv[1]);
-        return -1;
+    MotionFilter motion;
+    YuvStream yuv_stream;
+    Pipeline pipeline = { .extract = pExtract, .pCodecContext = pCodecContext, .yuv = yuv, .playlist = nb_inputs > 1 ? &playlist : NULL };
+    atomic_init(&pipeline.decode_error, 0);
+    if (yuv_path) {
+        if (yuv_stream_open(&yuv_stream, yuv_path) < 0)
+            return -1;
+        pipeline.yuv_stream = &yuv_stream;
     }
-
-    AVCodecContext *pCodecContext = avcodec_alloc_context3(pCodec);
-    if (!pCodecContext) {
-        logging("failed to allocated memory for AVCodecContext");
-        return -1;
+    if (motion_threshold >= 0) {
+        if (motion_filter_init(&motion, motion_threshold, "motion") < 0)
+            return -1;
+        pipeline.motion = &motion;
     }
-
-    // Fill the codec context based on the values from the supplied codec parameters
-    if (avcodec_parameters_to_context(pCodecContext, pCodecParameters) < 0){
-        logging("failed to copy codec params to codec context");
+    if (spsc_queue_init(&pipeline.packets, PACKET_QUEUE_SIZE) < 0 || mpmc_queue_init(&pipeline.frames, FRAME_QUEUE_SIZE) < 0) {
+        logging("failed to allocate the pipeline queues");
         return -1;
     }
 
-    // Initialize the AVCodecContext to use the given AVCodec.
-    if (avcodec_open2(pCodecContext, pCodec, NULL) < 0){
-        logging("failed to open codec through avcodec_open2");
+    // start the decode stage and the writer pool before demuxing
+    pthread_t decoder, writers[MAX_WRITERS];
+    if (pthread_create(&decoder, NULL, decode_thread, &pipeline) != 0) {
+        logging("failed to start the decode thread");
         return -1;
     }
-
-    AVFrame *pFrame = av_frame_alloc();
-    if (!pFrame) {
-        logging("failed to allocate memory for AVFrame");
-        return -1;
+    for (int i = 0; i < nb_writers; i++) {
+        if (pthread_create(&writers[i], NULL, writer_thread, &pipeline) != 0) {
+            logging("failed to start writer thread %d", i);
+            nb_writers = i;
+            break;
+        }
     }
-
-    AVPacket *pPacket = av_packet_alloc();
-    if (!pPacket) {
-        logging("failed to allocate memory for AVPacket");
-        return -1;
+    if (nb_writers == 0) {
+        // still drain the pipeline so nothing blocks, but there is nobody to write
+        atomic_store(&pipeline.decode_error, 1);
     }
+    logging("pipeline: 1 decode thread, %ld writer threads", nb_writers);
+
+    // the audio packets of the same read go to their own decode thread
+    AudioAnalysis *audio = analyze_audio ? audio_analysis_start(pFormatContext, video_stream_index) : NULL;
 
-    int response = 0;
     int how_many_packets_to_process = 5; // choosing 8 packets to process from the stream
+    if (pipeline.motion)
+        how_many_packets_to_process = INT_MAX; // selection by motion looks at the whole stream
+    if (audio)
+        how_many_packets_to_process = INT_MAX; // the loudness series covers the whole audio track
+    if (pipeline.playlist)
+        how_many_packets_to_process = INT_MAX; // a playlist is extracted over its whole timeline
 
     // fill the Packet with data from the Stream
-    while (av_read_frame(pFormatContext, pPacket) >= 0) {
-   
+    for (;;) {
+        if (av_read_frame(pFormatContext, pPacket) < 0) {
+            // end of a playlist segment: the decoder drains it and the timeline goes on with the next one;
+            // the last segment is drained by the PIPELINE_END packet below
+            AVPacket *marker;
+            if (!pipeline.playlist || playlist_advance(pipeline.playlist) < 0 || !(marker = av_packet_alloc()))
+                break;
+            marker->stream_index = PLAYLIST_SEGMENT_END;
+            spsc_queue_push(&pipeline.packets, marker);
+
+            pExtract = playlist_current(pipeline.playlist);
+            pFormatContext = pExtract->pFormatContext;
+            video_stream_index = pExtract->video_stream_index;
+            pPacket = pExtract->pPacket;
+            continue;
+        }
+
         if (pPacket->stream_index == video_stream_index) { // if it's the video stream
             logging("AVPacket->pts %" PRId64, pPacket->pts);
-            response = decode_packet(pPacket, pCodecContext, pFrame); // decode packet form stream 
-            if (response < 0)
+            if (atomic_load(&pipeline.decode_error))
                 break; 
-    
+            // hand our reference over to the decode thread
+            AVPacket *queued = av_packet_alloc();
+            if (!queued) {
+                logging("failed to allocate memory for AVPacket");
+                break; 
+            }
+            av_packet_move_ref(queued, pPacket);
+            spsc_queue_push(&pipeline.packets, queued);
+
             if (--how_many_packets_to_process <= 0) break; // stop it when 8 packets are loaded
+        } else if (audio && pPacket->stream_index == audio_analysis_stream_index(audio)) {
+            AVPacket *queued = av_packet_alloc();
+            if (queued) {
+                av_packet_move_ref(queued, pPacket);
+                audio_analysis_send(audio, queued);
+            }
         }
         av_packet_unref(pPacket); // unreference packet to default values
     }
 
+    // end of stream: the decoder gives out the frames it still holds (reordered
+    // B-frames, delayed output), then each stage drains its queue and closes the next one
+    AVPacket *end = av_packet_alloc();
+    if (end) {
+        end->stream_index = PIPELINE_END;
+        spsc_queue_push(&pipeline.packets, end);
+    } else {
+        logging("failed to allocate memory for AVPacket, the last frames are not flushed");
+    }
+    spsc_queue_close(&pipeline.packets);
+    pthread_join(decoder, NULL);
+    for (int i = 0; i < nb_writers; i++)
+        pthread_join(writers[i], NULL);
+    if (audio_analysis_finish(audio, "audio") < 0)
+        atomic_store(&pipeline.decode_error, 1);
+    if (pipeline.motion)
+        motion_filter_close(pipeline.motion);
+    if (pipeline.yuv_stream && yuv_stream_close(pipeline.yuv_stream) < 0)
+        atomic_store(&pipeline.decode_error, 1);
+
     logging("releasing all the resources");
 
-    avformat_close_input(&pFormatContext); // close stream input
-    av_packet_free(&pPacket); // free packet resources
-    av_frame_free(&pFrame); // free frame resources
-    avcodec_free_context(&pCodecContext); // free context
+    if (pipeline.playlist)
+        playlist_close(pipeline.playlist);
+    else
+        extract_close(&extract);
+    spsc_queue_destroy(&pipeline.packets);
+    mpmc_queue_destroy(&pipeline.frames);
 
-    return 0;
-}
+    if (atomic_load(&pipeline.decode_error))
+        return -1;
 
-/**
- * @brief 
- * Function Definition of Logging out Messages
- * @param fmt 
- * @param ... 
- */
-static void logging(const char *fmt, ...){
-    va_list args;
-    fprintf( stderr, "{LOG}:-- " );
-    va_start( args, fmt );
-    vfprintf( stderr, fmt, args );
-    va_end( args );
-    fprintf( stderr, "\n" );
+    return 0;
 }
 
 /**
  * @brief 
  * Function to decode packets from stream 
- * @param pPacket 
+ * @param pPacket NULL flushes the decoder
  * @param pCodecContext 
  * @param pFrame 
+ * @param frames queue the decoded frames are handed to
+ * @param extract input the packets come from
+ * @param motion frame selection by motion energy, NULL to keep every frame
+ * @param playlist timeline the frames are numbered and timed on, NULL for a single input
  * @return int 
  */
-static int decode_packet(AVPacket *pPacket, AVCodecContext *pCodecContext, AVFrame *pFrame) {
+static int decode_packet(AVPacket *pPacket, AVCodecContext *pCodecContext, AVFrame *pFrame, MpmcQueue *frames, const ExtractContext *extract, MotionFilter *motion, Playlist *playlist) {
     int response = avcodec_send_packet(pCodecContext, pPacket);   // Supply raw packet data as input to a decoder
 
     if (response < 0) {
@@ -276,109 +551,228 @@ static int decode_packet(AVPacket *pPacket, AVCodecContext *pCodecContext, AVFra
         if (pFrame->format != AV_PIX_FMT_YUV420P) 
             logging("Warning: the generated file may not be a grayscale image, but could e.g. be just the R component if the video format is RGB");
         
-        //convert frame to RGG format
-        // pFrame = avFrameConvertPixelFormat(pFrame, AV_PIX_FMT_RGB24);
-
-        // save a grayscale frame into a .pgm file
-        save_gray_frame(pFrame->data[0], pFrame->linesize[0], pFrame->width, pFrame->height, pCodecContext->frame_number);
-        //save_rgb_frame(pFrame->data[0], pFrame->data, Frame->linesize, (enum AVPixelFormat)pFrame->format, pFrame->linesize[0], pFrame->width, pFrame->height, frame_filename);
-        save_rgb_frame(pFrame, pCodecContext->frame_number);
-        //refreshWindow
+        // frame number and timestamps continue across the segments of a playlist
+        int fnumber = playlist ? playlist_frame(playlist, pFrame, pCodecContext->frame_number) : pCodecContext->frame_number;
+
+        // motion vectors exported by the decoder: skip the frames without enough activity
+        if (motion && !motion_filter_select(motion, pFrame, fnumber))
+            continue;
+
+        extract_frame_properties(extract, pFrame); // aspect ratio and rotation for the writers
+        governor_frame();
+
+        // hand a new reference to the writer pool, the decoder reuses pFrame
+        FrameJob *job = malloc(sizeof(*job));
+        if (!job || !(job->frame = av_frame_clone(pFrame))) {
+            logging("failed to allocate memory for the frame job");
+            free(job);
+            return AVERROR(ENOMEM);
+        }
+        job->fnumber = fnumber;
+        mpmc_queue_push(frames, job);
         }
     }
     return 0; //exit 
 }
 
-//convert to rgba (contextWidth, contextHeight,)
+static void *decode_thread(void *arg) {
+    Pipeline *pipeline = arg;
+    const ExtractContext *extract = pipeline->extract;
+    AVCodecContext *pCodecContext = pipeline->pCodecContext;
+    AVPacket *pPacket;
 
-/**
- * @brief 
- * Function to save the frame as a grayscale
- * @param buf 
- * @param wrap 
- * @param xsize 
- * @param ysize 
- * @param filename 
- */
-static void save_gray_frame(unsigned char *buf,  int wrap, int xsize, int ysize, int fnumber) {
-    char frame_filename[1024];
-    snprintf(frame_filename, sizeof(frame_filename), "%s-%d.pgm", "frame", fnumber);
-    char *filename = frame_filename;
-    FILE *f;
-    int i;
-    f = fopen(filename,"w"); // writing the minimal required header for a pgm file format
-    
-      // portable graymap format -> https://en.wikipedia.org/wiki/Netpbm_format#PGM_example
-    fprintf(f, "P5\n%d %d\n%d\n", xsize, ysize, 255);
-
-    // writing line by line
-    for (i = 0; i < ysize; i++)
-        fwrite(buf + i * wrap, 1, xsize, f);
-    fclose(f);
-}
+    AVFrame *pFrame = av_frame_alloc();
+    if (!pFrame) {
+        logging("failed to allocate memory for AVFrame");
+        atomic_store(&pipeline->decode_error, 1);
+    }
 
+    while ((pPacket = spsc_queue_pop(&pipeline->packets))) {
+        // after an error keep draining so the demuxer never blocks on a full queue;
+        // the markers flush the decoder: PLAYLIST_SEGMENT_END between two segments,
+        // PIPELINE_END after the last one (or the only input)
+        AVPacket *input = pPacket->stream_index == PLAYLIST_SEGMENT_END || pPacket->stream_index == PIPELINE_END ? NULL : pPacket;
+        if (!atomic_load(&pipeline->decode_error) &&
+            decode_packet(input, pCodecContext, pFrame, &pipeline->frames, extract, pipeline->motion, pipeline->playlist) < 0)
+            atomic_store(&pipeline->decode_error, 1);
+        if (pPacket->stream_index == PLAYLIST_SEGMENT_END) {
+            extract = playlist_next_decoder(pipeline->playlist);
+            pCodecContext = extract->pCodecContext;
+        }
+        av_packet_free(&pPacket);
+    }
 
-static void save_rgb_frame(AVFrame *pFrame, int fnumber) {
-    char frame_filename[1024];
-    snprintf(frame_filename, sizeof(frame_filename), "%s-%d.ppm", "frame", fnumber);
-    char *filename = frame_filename;
-    FILE *f;
-    int i;
-    f = fopen(filename,"w"); // writing the minimal required header for a pgm file format
-    
-    // write header
-    fprintf(f, "P6\n%d %d\n255\n", pFrame->width, pFrame->height);
-
-    // create scaling to convert to rgb
-    AVFrame* frame_rgb = allocateFrame(pFrame->width, pFrame->height);
-    // source(src)=> pFrame  & destination(dst) => frame_rgb
-    // refer: https://ffmpeg.org/doxygen/3.1/scaling_video_8c-example.html
-    // use swscale for conversion  ->  sws_ctx = sws_getContext(src_w, src_h, src_pix_fmt, dst_w, dst_h, dst_pix_fmt, SWS_BILINEAR, NULL, NULL, NULL);
-    struct SwsContext* converted_data = sws_getContext(pFrame->width, pFrame->height, pFrame->format, frame_rgb->width,frame_rgb->height, dst_pix_fmt, SWS_FAST_BILINEAR | SWS_FULL_CHR_H_INT | SWS_ACCURATE_RND, NULL, NULL, NULL);
-    sws_scale(converted_data,(uint8_t const * const *)pFrame->data, pFrame->linesize, 0, pFrame->height, frame_rgb->data, frame_rgb->linesize);
-    sws_freeContext(converted_data);
-
-    for (i = 0; i < frame_rgb->height; i++) 
-        fwrite(frame_rgb->data[0] + i * frame_rgb->linesize[0], 1, frame_rgb->width * 3, f);
-    fclose(f);
+    mpmc_queue_close(&pipeline->frames);
+    av_frame_free(&pFrame); // free frame resources
+    return NULL;
 }
 
-static AVFrame* allocateFrame(int width, int height){
+static void *writer_thread(void *arg) {
+    Pipeline *pipeline = arg;
+    FrameJob *job;
+
+    while ((job = mpmc_queue_pop(&pipeline->frames))) {
+        AVFrame *pFrame = job->frame;
+        int ret;
+        if (pipeline->yuv_stream) {
+            ret = yuv_stream_write(pipeline->yuv_stream, pFrame, job->fnumber);
+        } else if (pipeline->yuv) {
+            ret = save_yuv_frame(pFrame, "frame", job->fnumber); // the planes as decoded, no swscale
+        } else {
+            // save a grayscale frame into a .pgm file
+            ret = save_gray_frame(pFrame->data[0], pFrame->linesize[0], pFrame->width, pFrame->height, "frame", job->fnumber);
+            int rgb = save_rgb_frame(pFrame, "frame", job->fnumber);
+            if (ret == 0)
+                ret = rgb;
+        }
+        // a failed write stops the demuxer like a decoding error and fails the run
+        if (ret < 0)
+            atomic_store(&pipeline->decode_error, 1);
+        av_frame_free(&job->frame);
+        free(job);
+    }
+    return NULL;
+}
+
+static int extract_at_times(ExtractContext *extract, char *times) {
+    FrameSeeker seeker;
+    frame_seeker_init(&seeker, extract);
+
+    AVFrame *pFrame = av_frame_alloc();
+    if (!pFrame) {
+        logging("failed to allocate memory for AVFrame");
+        return -1;
+    }
+
+    int fnumber = 0, nb_seeks = 0, ret = 0;
+    char *saveptr = NULL;
+    for (char *time = strtok_r(times, ",", &saveptr); time; time = strtok_r(NULL, ",", &saveptr)) {
+        char *end;
+        double seconds = strtod(time, &end);
+        if (end == time || *end || seconds < 0) {
+            logging("invalid time '%s'", time);
+            ret = -1;
+            break;
+        }
+
+        SeekStrategy strategy;
+        int response = frame_seeker_get(&seeker, seconds, pFrame, &strategy);
+        if (response < 0) {
+            logging("no frame at %.3f s: %s", seconds, av_err2str(response));
+            ret = -1;
+            break;
+        }
+        nb_seeks += strategy == SEEK_STRATEGY_SEEK;
+
+        // outputs are numbered in the order the times were given
+        fnumber++;
+        logging("frame-%d: %.3f s -> pts %" PRId64 " (%s)", fnumber, seconds, pFrame->best_effort_timestamp, seek_strategy_name(strategy));
+        governor_frame();
+        if (save_gray_frame(pFrame->data[0], pFrame->linesize[0], pFrame->width, pFrame->height, "frame", fnumber) < 0 ||
+            save_rgb_frame(pFrame, "frame", fnumber) < 0) {
+            ret = -1;
+            break;
+        }
+    }
 
-    AVFrame* newFrame = av_frame_alloc();
-    if (newFrame == NULL)
-        fprintf(stderr, "could not allocate destination frame");
-  
-    if (av_image_alloc(newFrame->data, newFrame->linesize, width, height, dst_pix_fmt, 1) < 0) 
-        fprintf(stderr, "Could not allocate destination image");
-  
-    newFrame->width = width;
-    newFrame->height = height;
-    newFrame->format = dst_pix_fmt;
+    logging("%d frames extracted, %d seeks, %d continued", fnumber, nb_seeks, fnumber - nb_seeks);
+    av_frame_free(&pFrame);
+    return ret;
+}
 
-    return newFrame;
+static int extract_passthrough(ExtractContext *extract, enum AVCodecID codec_id) {
+    AVPacket *pPacket = extract->pPacket;
+    int how_many_packets_to_process = 5; // same selection as the decoding pipeline
+    int fnumber = 0, ret = 0;
+
+    logging("%s packets are standalone images, writing them without decoding", avcodec_get_name(codec_id));
+    while (how_many_packets_to_process > 0 && av_read_frame(extract->pFormatContext, pPacket) >= 0) {
+        if (pPacket->stream_index == extract->video_stream_index) {
+            how_many_packets_to_process--;
+            if (passthrough_write_packet(pPacket, codec_id, "frame", ++fnumber) < 0) {
+                ret = -1;
+                av_packet_unref(pPacket);
+                break;
+            }
+        }
+        av_packet_unref(pPacket);
+    }
+    logging("%d images written as .%s", fnumber, passthrough_extension(codec_id));
+    return ret;
 }
 
+static int extract_best_thumbnails(ExtractContext *extract, double window) {
+    AVStream *stream = extract->pFormatContext->streams[extract->video_stream_index];
+    double time_base = av_q2d(stream->time_base);
+    double start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time * time_base : 0;
+    AVRational rate = stream->avg_frame_rate.num ? stream->avg_frame_rate : stream->r_frame_rate;
+    double frame_interval = rate.num > 0 ? av_q2d((AVRational){ rate.den, rate.num }) : 1 / 25.0;
 
+    AVFrame *pFrame = av_frame_alloc();
+    AVFrame *best = av_frame_alloc();
+    if (!pFrame || !best) {
+        logging("failed to allocate memory for AVFrame");
+        av_frame_free(&pFrame);
+        av_frame_free(&best);
+        return -1;
+    }
 
+    FrameScore best_score = { 0 };
+    int64_t current = -1; // window of the frames being compared
+    int candidates = 0, written = 0, ret = 0, response;
+    double t = -frame_interval;
 
+    for (;;) {
+        response = extract_next_frame(extract, pFrame);
+        if (response < 0 && response != AVERROR_EOF) {
+            logging("Error while decoding: %s", av_err2str(response));
+            ret = -1;
+        }
 
-//75% DONE
+        int64_t index = -1;
+        if (response == 0) {
+            t = pFrame->best_effort_timestamp != AV_NOPTS_VALUE ? pFrame->best_effort_timestamp * time_base - start : t + frame_interval;
+            index = t > 0 ? (int64_t)(t / window) : 0;
+        }
 
-// producer():
-// define buffer[]
-//define max_frames=num_of_packets_to_process, lock, size
-// processPacket() => buffer => PRODUCER_LOGIC
-// for(i < maxItems)
-//      decodeFrame()
-//      wait()
-//      lock()
-//      addFrameToBuffer()
-//      increase bufferSize
-//      unlock()
-//      signal()
+        // leaving a window: only its winner gets converted and written
+        if (index != current && current >= 0 && best->data[0]) {
+            logging("window %" PRId64 ": best of %d frames, pts %" PRId64 ", sharpness %.1f, spread %.2f",
+                    current + 1, candidates, best->best_effort_timestamp, best_score.sharpness, best_score.spread);
+            governor_frame();
+            if (save_gray_frame(best->data[0], best->linesize[0], best->width, best->height, "frame", (int)current + 1) < 0 ||
+                save_rgb_frame(best, "frame", (int)current + 1) < 0) {
+                ret = -1;
+                break;
+            }
+            av_frame_unref(best);
+            written++;
+        }
+        if (response < 0)
+            break;
+        if (index != current) {
+            current = index;
+            candidates = 0;
+            best_score.score = -1;
+        }
 
-// consumer():
-// timer()
-// 
+        FrameScore score;
+        if (thumbnail_score(pFrame, &score) < 0)
+            score = (FrameScore){ 0, 0, 0 }; // unscorable format: first frame of the window wins
+        candidates++;
+        if (score.score > best_score.score) {
+            av_frame_unref(best);
+            if (av_frame_ref(best, pFrame) < 0) {
+                logging("failed to keep a reference to the best frame");
+                ret = -1;
+                break;
+            }
+            best_score = score;
+        }
+    }
 
+    logging("%d thumbnails written", written);
+    av_frame_free(&pFrame);
+    av_frame_free(&best);
+    return ret;
+}
@@ -0,0 +1,222 @@
+/**
+ * @file analyze.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Decode-free stream analysis, see analyze.h.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include <libavutil/avutil.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "analyze.h"
+#include "extract.h"
+
+/**
+ * @brief
+ * Growable array of int64_t
+ */
+typedef struct Series {
+    int64_t *values;
+    size_t count;
+    size_t capacity;
+} Series;
+
+/**
+ * @brief
+ * Make series hold at least size values, new ones zeroed
+ * @return int 0 or -1 when out of memory
+ */
+static int series_resize(Series *series, size_t size) {
+    if (size > series->capacity) {
+        size_t capacity = series->capacity ? series->capacity : 64;
+        while (capacity < size)
+            capacity *= 2;
+        int64_t *values = realloc(series->values, capacity * sizeof(*values));
+        if (!values)
+            return -1;
+        memset(values + series->capacity, 0, (capacity - series->capacity) * sizeof(*values));
+        series->values = values;
+        series->capacity = capacity;
+    }
+    if (size > series->count)
+        series->count = size;
+    return 0;
+}
+
+static int series_append(Series *series, int64_t value) {
+    if (series_resize(series, series->count + 1) < 0)
+        return -1;
+    series->values[series->count - 1] = value;
+    return 0;
+}
+
+/**
+ * @brief
+ * Everything gathered while scanning the packets
+ */
+typedef struct StreamStats {
+    int64_t frames;
+    int64_t bytes;
+    int64_t gop_frames;     // frames since the last keyframe, -1 before the first one
+    Series keyframes;       // frame number, pts pairs
+    Series gop_histogram;   // index = GOP length in frames
+    Series bitrate;         // index = second, bits
+    int64_t first_ts;       // earliest packet timestamp, AV_NOPTS_VALUE if none
+    int64_t last_ts;        // latest packet timestamp
+    int64_t last_duration;  // duration of the packet at last_ts, 0 if unknown
+} StreamStats;
+
+static int stats_add_packet(StreamStats *stats, const AVPacket *pPacket, int64_t start, AVRational time_base) {
+    int64_t ts = pPacket->pts != AV_NOPTS_VALUE ? pPacket->pts : pPacket->dts;
+
+    if (pPacket->flags & AV_PKT_FLAG_KEY) {
+        // a keyframe closes the GOP that was open
+        if (stats->gop_frames > 0) {
+            if (series_resize(&stats->gop_histogram, stats->gop_frames + 1) < 0)
+                return -1;
+            stats->gop_histogram.values[stats->gop_frames]++;
+        }
+        if (series_append(&stats->keyframes, stats->frames) < 0 || series_append(&stats->keyframes, ts) < 0)
+            return -1;
+        stats->gop_frames = 0;
+    }
+    if (stats->gop_frames >= 0)
+        stats->gop_frames++;
+
+    if (ts != AV_NOPTS_VALUE) {
+        if (stats->first_ts == AV_NOPTS_VALUE || ts < stats->first_ts)
+            stats->first_ts = ts;
+        if (stats->last_ts == AV_NOPTS_VALUE || ts >= stats->last_ts) {
+            stats->last_ts = ts;
+            stats->last_duration = pPacket->duration;
+        }
+    }
+
+    if (ts != AV_NOPTS_VALUE && ts >= start) {
+        int64_t second = av_rescale_q(ts - start, time_base, AV_TIME_BASE_Q) / AV_TIME_BASE;
+        if (series_resize(&stats->bitrate, second + 1) < 0)
+            return -1;
+        stats->bitrate.values[second] += pPacket->size * 8LL;
+    }
+
+    stats->frames++;
+    stats->bytes += pPacket->size;
+    return 0;
+}
+
+static void write_json_string(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\')
+            fprintf(out, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(out, "\\u%04x", c);
+        else
+            fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+static void write_report(FILE *out, const char *input, const ExtractContext *extract, const StreamStats *stats, int64_t start) {
+    const AVStream *stream = extract->pFormatContext->streams[extract->video_stream_index];
+    const AVCodecParameters *par = stream->codecpar;
+    AVRational time_base = stream->time_base;
+    // first to last packet, plus the display time of the last one
+    double duration = 0;
+    if (stats->first_ts != AV_NOPTS_VALUE) {
+        AVRational rate = stream->avg_frame_rate.num ? stream->avg_frame_rate : stream->r_frame_rate;
+        double last = stats->last_duration > 0 ? stats->last_duration * av_q2d(time_base) : rate.num > 0 ? 1 / av_q2d(rate) : 0;
+        duration = (stats->last_ts - stats->first_ts) * av_q2d(time_base) + last;
+    }
+
+    fprintf(out, "{\n  \"input\": ");
+    write_json_string(out, input);
+    fprintf(out, ",\n  \"format\": \"%s\",\n", extract->pFormatContext->iformat->name);
+    fprintf(out, "  \"codec\": \"%s\",\n", avcodec_get_name(par->codec_id));
+    fprintf(out, "  \"width\": %d,\n  \"height\": %d,\n", par->width, par->height);
+    fprintf(out, "  \"time_base\": \"%d/%d\",\n", time_base.num, time_base.den);
+    fprintf(out, "  \"frame_count\": %" PRId64 ",\n", stats->frames);
+    fprintf(out, "  \"bytes\": %" PRId64 ",\n", stats->bytes);
+    fprintf(out, "  \"average_bitrate\": %.0f,\n", duration > 0 ? stats->bytes * 8 / duration : 0.0);
+
+    fprintf(out, "  \"keyframe_count\": %zu,\n  \"keyframes\": [", stats->keyframes.count / 2);
+    for (size_t i = 0; i < stats->keyframes.count; i += 2) {
+        int64_t pts = stats->keyframes.values[i + 1];
+        fprintf(out, "%s\n    { \"frame\": %" PRId64 ", \"pts\": ", i ? "," : "", stats->keyframes.values[i]);
+        if (pts == AV_NOPTS_VALUE)
+            fprintf(out, "null, \"time\": null }");
+        else
+            fprintf(out, "%" PRId64 ", \"time\": %.6f }", pts, (pts - start) * av_q2d(time_base));
+    }
+    fprintf(out, "%s],\n", stats->keyframes.count ? "\n  " : "");
+
+    // GOP length in frames -> number of GOPs; the GOP still open at the end counts too
+    fprintf(out, "  \"gop_histogram\": {");
+    int first = 1;
+    for (size_t length = 1; length < stats->gop_histogram.count; length++) {
+        int64_t count = stats->gop_histogram.values[length] + (stats->gop_frames == (int64_t)length);
+        if (!count)
+            continue;
+        fprintf(out, "%s \"%zu\": %" PRId64, first ? "" : ",", length, count);
+        first = 0;
+    }
+    if (stats->gop_frames >= (int64_t)stats->gop_histogram.count)
+        fprintf(out, "%s \"%" PRId64 "\": 1", first ? "" : ",", stats->gop_frames);
+    fprintf(out, " },\n");
+
+    // bits per second, one entry per second of stream time
+    fprintf(out, "  \"bitrate\": [");
+    for (size_t second = 0; second < stats->bitrate.count; second++)
+        fprintf(out, "%s%" PRId64, second ? ", " : "", stats->bitrate.values[second]);
+    fprintf(out, "]\n}\n");
+}
+
+int analyze_stream(const char *input, FILE *out) {
+    ExtractContext extract = { .video_stream_index = -1 };
+    if (extract_open_input(&extract, input) < 0)
+        return -1;
+
+    AVFormatContext *pFormatContext = extract.pFormatContext;
+    AVStream *stream = pFormatContext->streams[extract.video_stream_index];
+    AVPacket *pPacket = extract.pPacket;
+
+    // let the demuxer drop every other stream as early as it can
+    for (unsigned i = 0; i < pFormatContext->nb_streams; i++)
+        if (i != (unsigned)extract.video_stream_index)
+            pFormatContext->streams[i]->discard = AVDISCARD_ALL;
+
+    int64_t start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    StreamStats stats = { .gop_frames = -1, .first_ts = AV_NOPTS_VALUE, .last_ts = AV_NOPTS_VALUE };
+    int ret = 0;
+
+    while (av_read_frame(pFormatContext, pPacket) >= 0) {
+        if (pPacket->stream_index == extract.video_stream_index && stats_add_packet(&stats, pPacket, start, stream->time_base) < 0) {
+            logging("failed to allocate memory for the analysis");
+            ret = -1;
+            av_packet_unref(pPacket);
+            break;
+        }
+        av_packet_unref(pPacket);
+    }
+
+    if (ret == 0) {
+        logging("analyzed %" PRId64 " frames, %zu keyframes", stats.frames, stats.keyframes.count / 2);
+        write_report(out, input, &extract, &stats, start);
+    }
+
+    free(stats.keyframes.values);
+    free(stats.gop_histogram.values);
+    free(stats.bitrate.values);
+    extract_close(&extract);
+    return ret;
+}
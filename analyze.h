@@ -0,0 +1,30 @@
+/**
+ * @file analyze.h
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Decode-free stream analysis: frame count, keyframe positions, GOP length
+ * histogram and bitrate per second, computed from the packets the demuxer
+ * returns (size, flags, timestamps) without opening a decoder.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef A3_ANALYZE_H
+#define A3_ANALYZE_H
+
+#include <stdio.h>
+
+/**
+ * @brief
+ * Scan the first video stream of input and write the report as JSON
+ * @param input media file
+ * @param out e.g. stdout
+ * @return int 0 on success, -1 on failure
+ */
+int analyze_stream(const char *input, FILE *out);
+
+#endif
@@ -0,0 +1,349 @@
+/**
+ * @file async.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Asynchronous extraction API, see async.h. Each AsyncLoop owns two thread
+ * pools fed by MPMC task queues (queue.h): one for decoding, one for output.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "async.h"
+#include "extract.h"
+#include "governor.h"
+#include "queue.h"
+#include "writer.h"
+
+#define ASYNC_QUEUE_SIZE 65536 // also the most sessions and sinks a loop has open at once
+#define ASYNC_MAX_THREADS 256
+
+typedef struct AsyncTask {
+    void (*run)(void *arg);
+    void *arg;
+} AsyncTask;
+
+typedef struct AsyncPool {
+    AsyncLoop *loop;
+    MpmcQueue tasks;
+    pthread_t threads[ASYNC_MAX_THREADS];
+    int nb_threads;
+} AsyncPool;
+
+struct AsyncLoop {
+    AsyncPool cpu;
+    AsyncPool io;
+    atomic_int nb_objects;  // sessions and sinks, see loop_add_object()
+    pthread_mutex_t lock;
+    pthread_cond_t idle;    // signaled when pending drops to 0
+    int pending;            // tasks queued or running on either pool
+    int stopping;           // no more tasks accepted
+};
+
+struct AsyncSession {
+    AsyncLoop *loop;
+    ExtractContext extract;
+    atomic_int busy;
+    char *input;              // only while opening
+    AsyncOpenCallback open_cb;
+    AsyncFrameCallback frame_cb;
+    void *opaque;
+};
+
+struct AsyncSink {
+    AsyncLoop *loop;
+    atomic_int busy;
+    char *prefix;
+    int fnumber;
+    AVFrame *frame;
+    AsyncWriteCallback cb;
+    void *opaque;
+};
+
+/**
+ * @brief
+ * Count a session or sink in. Each one has at most one task queued, so with
+ * no more of them than a task queue holds, pushing a task never blocks.
+ * @return int 0 or AVERROR(EAGAIN) if the loop is full
+ */
+static int loop_add_object(AsyncLoop *loop) {
+    if (atomic_fetch_add(&loop->nb_objects, 1) >= ASYNC_QUEUE_SIZE) {
+        atomic_fetch_sub(&loop->nb_objects, 1);
+        return AVERROR(EAGAIN);
+    }
+    return 0;
+}
+
+static void loop_remove_object(AsyncLoop *loop) {
+    atomic_fetch_sub(&loop->nb_objects, 1);
+}
+
+static void loop_task_done(AsyncLoop *loop) {
+    pthread_mutex_lock(&loop->lock);
+    if (--loop->pending == 0)
+        pthread_cond_broadcast(&loop->idle);
+    pthread_mutex_unlock(&loop->lock);
+}
+
+static void *pool_thread(void *arg) {
+    AsyncPool *pool = arg;
+    AsyncTask *task;
+
+    while ((task = mpmc_queue_pop(&pool->tasks))) {
+        AsyncTask run = *task;
+        free(task);
+        // anything the task queues from its callback is pending before it is done
+        run.run(run.arg);
+        loop_task_done(pool->loop);
+    }
+    return NULL;
+}
+
+static int pool_start(AsyncPool *pool, AsyncLoop *loop, int nb_threads) {
+    pool->loop = loop;
+    if (mpmc_queue_init(&pool->tasks, ASYNC_QUEUE_SIZE) < 0)
+        return -1;
+    nb_threads = nb_threads > ASYNC_MAX_THREADS ? ASYNC_MAX_THREADS : nb_threads;
+    for (pool->nb_threads = 0; pool->nb_threads < nb_threads; pool->nb_threads++)
+        if (pthread_create(&pool->threads[pool->nb_threads], NULL, pool_thread, pool) != 0)
+            break;
+    return pool->nb_threads > 0 ? 0 : -1;
+}
+
+static void pool_stop(AsyncPool *pool) {
+    mpmc_queue_close(&pool->tasks);
+    for (int i = 0; i < pool->nb_threads; i++)
+        pthread_join(pool->threads[i], NULL);
+    mpmc_queue_destroy(&pool->tasks);
+}
+
+/**
+ * @brief
+ * Queue run(arg) on pool. The push cannot block (see loop_add_object()), so
+ * loop threads may submit too, and the callbacks never run inside the call.
+ * @return int 0, AVERROR(ENOMEM) or AVERROR(EINVAL) once the loop is stopping
+ */
+static int pool_submit(AsyncPool *pool, void (*run)(void *), void *arg) {
+    AsyncLoop *loop = pool->loop;
+    AsyncTask *task = malloc(sizeof(*task));
+    if (!task)
+        return AVERROR(ENOMEM);
+    task->run = run;
+    task->arg = arg;
+
+    // counted under the lock: async_loop_destroy() waits for every task accepted here
+    pthread_mutex_lock(&loop->lock);
+    int stopping = loop->stopping;
+    if (!stopping)
+        loop->pending++;
+    pthread_mutex_unlock(&loop->lock);
+    if (stopping) {
+        free(task);
+        return AVERROR(EINVAL);
+    }
+    if (mpmc_queue_push(&pool->tasks, task) < 0) {
+        free(task);
+        loop_task_done(loop);
+        return AVERROR(EINVAL);
+    }
+    return 0;
+}
+
+AsyncLoop *async_loop_create(int cpu_threads, int io_threads) {
+    AsyncLoop *loop = calloc(1, sizeof(*loop));
+    if (!loop)
+        return NULL;
+    if (cpu_threads <= 0)
+        cpu_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (io_threads <= 0)
+        io_threads = 2;
+
+    atomic_init(&loop->nb_objects, 0);
+    pthread_mutex_init(&loop->lock, NULL);
+    pthread_cond_init(&loop->idle, NULL);
+    if (pool_start(&loop->cpu, loop, cpu_threads) < 0) {
+        pthread_mutex_destroy(&loop->lock);
+        pthread_cond_destroy(&loop->idle);
+        free(loop);
+        return NULL;
+    }
+    if (pool_start(&loop->io, loop, io_threads) < 0) {
+        pool_stop(&loop->cpu);
+        pthread_mutex_destroy(&loop->lock);
+        pthread_cond_destroy(&loop->idle);
+        free(loop);
+        return NULL;
+    }
+    return loop;
+}
+
+void async_loop_destroy(AsyncLoop *loop) {
+    if (!loop)
+        return;
+    // callbacks on either pool may chain more work onto the other one:
+    // wait until both are idle, only then close the queues
+    pthread_mutex_lock(&loop->lock);
+    while (loop->pending > 0)
+        pthread_cond_wait(&loop->idle, &loop->lock);
+    loop->stopping = 1;
+    pthread_mutex_unlock(&loop->lock);
+
+    pool_stop(&loop->cpu);
+    pool_stop(&loop->io);
+    pthread_mutex_destroy(&loop->lock);
+    pthread_cond_destroy(&loop->idle);
+    free(loop);
+}
+
+/* ------------------------------------------------------------ sessions */
+
+static void session_open_task(void *arg) {
+    AsyncSession *session = arg;
+    AsyncOpenCallback cb = session->open_cb;
+    void *opaque = session->opaque;
+
+    int ret = extract_open(&session->extract, session->input);
+    free(session->input);
+    session->input = NULL;
+    atomic_store(&session->busy, 0);
+
+    if (ret < 0) {
+        loop_remove_object(session->loop);
+        free(session);
+        cb(opaque, NULL, ret);
+        return;
+    }
+    cb(opaque, session, 0);
+}
+
+int async_session_open(AsyncLoop *loop, const char *input, AsyncOpenCallback cb, void *opaque) {
+    int ret = loop_add_object(loop);
+    if (ret < 0)
+        return ret;
+    AsyncSession *session = calloc(1, sizeof(*session));
+    if (!session || !(session->input = strdup(input))) {
+        free(session);
+        loop_remove_object(loop);
+        return AVERROR(ENOMEM);
+    }
+    session->loop = loop;
+    session->extract.video_stream_index = -1;
+    session->open_cb = cb;
+    session->opaque = opaque;
+    atomic_init(&session->busy, 1);
+
+    ret = pool_submit(&loop->cpu, session_open_task, session);
+    if (ret < 0) {
+        free(session->input);
+        free(session);
+        loop_remove_object(loop);
+    }
+    return ret;
+}
+
+static void session_frame_task(void *arg) {
+    AsyncSession *session = arg;
+    AsyncFrameCallback cb = session->frame_cb;
+    void *opaque = session->opaque;
+
+    AVFrame *frame = av_frame_alloc();
+    int ret = frame ? extract_next_frame(&session->extract, frame) : AVERROR(ENOMEM);
+    if (ret < 0)
+        av_frame_free(&frame);
+
+    // release the session before the callback so it can ask for the next frame
+    atomic_store(&session->busy, 0);
+    cb(opaque, frame, ret);
+}
+
+int async_session_next_frame(AsyncSession *session, AsyncFrameCallback cb, void *opaque) {
+    if (atomic_exchange(&session->busy, 1))
+        return AVERROR(EBUSY);
+    session->frame_cb = cb;
+    session->opaque = opaque;
+
+    int ret = pool_submit(&session->loop->cpu, session_frame_task, session);
+    if (ret < 0)
+        atomic_store(&session->busy, 0);
+    return ret;
+}
+
+void async_session_close(AsyncSession *session) {
+    if (!session)
+        return;
+    extract_close(&session->extract);
+    loop_remove_object(session->loop);
+    free(session);
+}
+
+/* --------------------------------------------------------------- sinks */
+
+static void sink_write_task(void *arg) {
+    AsyncSink *sink = arg;
+    AsyncWriteCallback cb = sink->cb;
+    void *opaque = sink->opaque;
+    AVFrame *frame = sink->frame;
+
+    sink->frame = NULL;
+    governor_frame();
+    int ret = save_gray_frame(frame->data[0], frame->linesize[0], frame->width, frame->height, sink->prefix, sink->fnumber);
+    int rgb = save_rgb_frame(frame, sink->prefix, sink->fnumber);
+    if (ret == 0)
+        ret = rgb;
+    av_frame_free(&frame);
+
+    atomic_store(&sink->busy, 0);
+    if (cb)
+        cb(opaque, ret);
+}
+
+AsyncSink *async_sink_create(AsyncLoop *loop, const char *prefix) {
+    if (loop_add_object(loop) < 0)
+        return NULL;
+    AsyncSink *sink = calloc(1, sizeof(*sink));
+    if (!sink || !(sink->prefix = strdup(prefix))) {
+        free(sink);
+        loop_remove_object(loop);
+        return NULL;
+    }
+    sink->loop = loop;
+    atomic_init(&sink->busy, 0);
+    return sink;
+}
+
+int async_sink_write(AsyncSink *sink, const AVFrame *frame, AsyncWriteCallback cb, void *opaque) {
+    if (atomic_exchange(&sink->busy, 1))
+        return AVERROR(EBUSY);
+    if (!(sink->frame = av_frame_clone(frame))) {
+        atomic_store(&sink->busy, 0);
+        return AVERROR(ENOMEM);
+    }
+    sink->fnumber++;
+    sink->cb = cb;
+    sink->opaque = opaque;
+
+    int ret = pool_submit(&sink->loop->io, sink_write_task, sink);
+    if (ret < 0) {
+        av_frame_free(&sink->frame);
+        sink->fnumber--;
+        atomic_store(&sink->busy, 0);
+    }
+    return ret;
+}
+
+void async_sink_destroy(AsyncSink *sink) {
+    if (!sink)
+        return;
+    loop_remove_object(sink->loop);
+    free(sink->prefix);
+    free(sink);
+}
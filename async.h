@@ -0,0 +1,131 @@
+/**
+ * @file async.h
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Asynchronous extraction API for event-driven services. Instead of blocking
+ * a thread per extraction, every operation is queued on a shared AsyncLoop
+ * and completes through a callback:
+ *
+ *   - decode work (open, next frame) runs on the loop's CPU threads
+ *   - file output (sink writes) runs on the loop's I/O threads
+ *
+ * A session or sink only ever has one operation in flight, so thousands of
+ * concurrent extractions share the handful of OS threads owned by the loop.
+ * Callbacks run on a loop thread and may start the next operation directly.
+ * extract_coro.hpp wraps this API into C++20 awaitables.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef A3_ASYNC_H
+#define A3_ASYNC_H
+
+#include <libavutil/frame.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct AsyncLoop AsyncLoop;
+typedef struct AsyncSession AsyncSession;
+typedef struct AsyncSink AsyncSink;
+
+/**
+ * @brief
+ * Completion of async_session_open()
+ * @param opaque user pointer
+ * @param session the opened session, NULL on failure
+ * @param status 0 or a negative AVERROR
+ */
+typedef void (*AsyncOpenCallback)(void *opaque, AsyncSession *session, int status);
+
+/**
+ * @brief
+ * Completion of async_session_next_frame()
+ * @param opaque user pointer
+ * @param frame decoded frame owned by the callee (av_frame_free() it), NULL unless status is 0
+ * @param status 0, AVERROR_EOF at the end of the stream, or a negative AVERROR
+ */
+typedef void (*AsyncFrameCallback)(void *opaque, AVFrame *frame, int status);
+
+/**
+ * @brief
+ * Completion of async_sink_write()
+ * @param opaque user pointer
+ * @param status 0 or a negative AVERROR
+ */
+typedef void (*AsyncWriteCallback)(void *opaque, int status);
+
+/**
+ * @brief
+ * Start the loop's threads
+ * @param cpu_threads decode threads, <= 0 for one per core
+ * @param io_threads output threads, <= 0 for 2
+ * @return AsyncLoop* or NULL
+ */
+AsyncLoop *async_loop_create(int cpu_threads, int io_threads);
+
+/**
+ * @brief
+ * Run every queued operation to completion, including the ones callbacks
+ * start meanwhile, then stop and free the loop. Call it from outside the
+ * loop; sessions and sinks must be closed from their last callback or before.
+ * @param loop
+ */
+void async_loop_destroy(AsyncLoop *loop);
+
+/**
+ * @brief
+ * Open input on a loop thread
+ * @return int 0 if the open was queued, <0 otherwise (the callback is not called):
+ *         AVERROR(EAGAIN) when the loop already has 65536 sessions and sinks
+ */
+int async_session_open(AsyncLoop *loop, const char *input, AsyncOpenCallback cb, void *opaque);
+
+/**
+ * @brief
+ * Decode the next video frame of the session on a loop thread
+ * @return int 0 if queued, AVERROR(EBUSY) if an operation is already in flight
+ */
+int async_session_next_frame(AsyncSession *session, AsyncFrameCallback cb, void *opaque);
+
+/**
+ * @brief
+ * Close a session that has no operation in flight
+ * @param session
+ */
+void async_session_close(AsyncSession *session);
+
+/**
+ * @brief
+ * Create a sink writing <prefix>-<n>.pgm/.ppm, numbering its frames from 1
+ * @param loop
+ * @param prefix output path prefix, e.g. "out/job42/frame"
+ * @return AsyncSink* NULL on failure, or when the loop already has 65536 sessions and sinks
+ */
+AsyncSink *async_sink_create(AsyncLoop *loop, const char *prefix);
+
+/**
+ * @brief
+ * Write frame on an I/O thread. The sink keeps its own reference, so the
+ * caller may free frame as soon as this returns.
+ * @return int 0 if queued, AVERROR(EBUSY) if a write is already in flight
+ */
+int async_sink_write(AsyncSink *sink, const AVFrame *frame, AsyncWriteCallback cb, void *opaque);
+
+/**
+ * @brief
+ * Free a sink that has no write in flight
+ * @param sink
+ */
+void async_sink_destroy(AsyncSink *sink);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,433 @@
+/**
+ * @file audio.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Single-pass audio loudness and waveform summary, see audio.h.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include <libavutil/samplefmt.h>
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "audio.h"
+#include "extract.h"
+#include "queue.h"
+
+#define AUDIO_PACKET_QUEUE_SIZE 256
+#define AUDIO_MAX_CHANNELS 8
+#define AUDIO_MOMENTARY_SEC 0.4  // BS.1770 momentary loudness block
+#define AUDIO_ABSOLUTE_GATE -70.0
+#define AUDIO_RELATIVE_GATE -10.0
+#define WAVEFORM_WIDTH 512
+#define WAVEFORM_HEIGHT 128
+
+/**
+ * @brief
+ * Second order IIR section, direct form I, one state per channel
+ */
+typedef struct Biquad {
+    double b0, b1, b2, a1, a2;
+    double x1[AUDIO_MAX_CHANNELS], x2[AUDIO_MAX_CHANNELS];
+    double y1[AUDIO_MAX_CHANNELS], y2[AUDIO_MAX_CHANNELS];
+} Biquad;
+
+/**
+ * @brief
+ * Accumulated over one window (one video frame duration)
+ */
+typedef struct AudioWindow {
+    double sum_squares;   // plain, averaged over the channels
+    double sum_weighted;  // K-weighted, summed over the channels
+    float peak;
+    int64_t samples;
+} AudioWindow;
+
+struct AudioAnalysis {
+    AVCodecContext *pCodecContext;
+    int stream_index;
+    AVRational time_base;
+    SpscQueue packets;
+    pthread_t thread;
+
+    double window_sec;
+    double video_start_sec;   // t = 0 of window 0
+    double samples_per_window;
+    int64_t next_sample;      // position of the next decoded sample, relative to video_start_sec
+    int have_position;
+
+    Biquad shelf, highpass;   // K-weighting: high shelf, then RLB high-pass
+    AudioWindow *windows;
+    size_t nb_windows;
+    size_t capacity;
+    int failed;
+};
+
+static inline double biquad_run(Biquad *f, int ch, double x) {
+    double y = f->b0 * x + f->b1 * f->x1[ch] + f->b2 * f->x2[ch] - f->a1 * f->y1[ch] - f->a2 * f->y2[ch];
+    f->x2[ch] = f->x1[ch];
+    f->x1[ch] = x;
+    f->y2[ch] = f->y1[ch];
+    f->y1[ch] = y;
+    return y;
+}
+
+/**
+ * @brief
+ * K-weighting filters of BS.1770 for any sample rate, from the analog
+ * prototypes through the bilinear transform (the same derivation libebur128 uses)
+ */
+static void k_weighting_init(AudioAnalysis *a, int sample_rate) {
+    double f0 = 1681.974450955533, gain_db = 3.999843853973347, q = 0.7071752369554196;
+    double k = tan(M_PI * f0 / sample_rate);
+    double vh = pow(10.0, gain_db / 20.0);
+    double vb = pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    a->shelf = (Biquad){
+        .b0 = (vh + vb * k / q + k * k) / a0, .b1 = 2.0 * (k * k - vh) / a0, .b2 = (vh - vb * k / q + k * k) / a0,
+        .a1 = 2.0 * (k * k - 1.0) / a0, .a2 = (1.0 - k / q + k * k) / a0,
+    };
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = tan(M_PI * f0 / sample_rate);
+    a0 = 1.0 + k / q + k * k;
+    a->highpass = (Biquad){
+        .b0 = 1.0, .b1 = -2.0, .b2 = 1.0,
+        .a1 = 2.0 * (k * k - 1.0) / a0, .a2 = (1.0 - k / q + k * k) / a0,
+    };
+}
+
+/**
+ * @brief
+ * Sample i of channel ch as a float in [-1, 1]
+ */
+static inline double sample_value(const AVFrame *frame, int planar, enum AVSampleFormat fmt, int channels, int ch, int i) {
+    const uint8_t *data = planar ? frame->extended_data[ch] : frame->extended_data[0];
+    int index = planar ? i : i * channels + ch;
+
+    switch (fmt) {
+    case AV_SAMPLE_FMT_U8:  return (data[index] - 128) / 128.0;
+    case AV_SAMPLE_FMT_S16: return ((const int16_t *)data)[index] / 32768.0;
+    case AV_SAMPLE_FMT_S32: return ((const int32_t *)data)[index] / 2147483648.0;
+    case AV_SAMPLE_FMT_FLT: return ((const float *)data)[index];
+    case AV_SAMPLE_FMT_DBL: return ((const double *)data)[index];
+    default:                return 0;
+    }
+}
+
+static AudioWindow *window_at(AudioAnalysis *a, size_t index) {
+    if (index >= a->capacity) {
+        size_t capacity = a->capacity ? a->capacity : 256;
+        while (capacity <= index)
+            capacity *= 2;
+        AudioWindow *windows = realloc(a->windows, capacity * sizeof(*windows));
+        if (!windows)
+            return NULL;
+        memset(windows + a->capacity, 0, (capacity - a->capacity) * sizeof(*windows));
+        a->windows = windows;
+        a->capacity = capacity;
+    }
+    if (index >= a->nb_windows)
+        a->nb_windows = index + 1;
+    return &a->windows[index];
+}
+
+static void process_frame(AudioAnalysis *a, const AVFrame *frame) {
+    int channels = frame->channels < AUDIO_MAX_CHANNELS ? frame->channels : AUDIO_MAX_CHANNELS;
+    int planar = av_sample_fmt_is_planar(frame->format);
+    enum AVSampleFormat fmt = av_get_packed_sample_fmt(frame->format);
+
+    if (frame->best_effort_timestamp != AV_NOPTS_VALUE) {
+        double t = frame->best_effort_timestamp * av_q2d(a->time_base) - a->video_start_sec;
+        a->next_sample = llrint(t * frame->sample_rate);
+        a->have_position = 1;
+    } else if (!a->have_position) {
+        a->next_sample = 0;
+        a->have_position = 1;
+    }
+    if (channels <= 0)
+        return;
+
+    AudioWindow *w = NULL;
+    int64_t window = -1;
+    for (int i = 0; i < frame->nb_samples; i++, a->next_sample++) {
+        double power = 0, weighted = 0, peak = 0;
+        for (int ch = 0; ch < channels; ch++) {
+            double x = sample_value(frame, planar, fmt, frame->channels, ch, i);
+            double k = biquad_run(&a->highpass, ch, biquad_run(&a->shelf, ch, x));
+            power += x * x;
+            weighted += k * k;
+            peak = fabs(x) > peak ? fabs(x) : peak;
+        }
+        if (a->next_sample < 0)
+            continue; // before the first video frame
+
+        int64_t index = (int64_t)(a->next_sample / a->samples_per_window);
+        if (index != window) {
+            window = index;
+            if (!(w = window_at(a, index))) {
+                a->failed = 1;
+                return;
+            }
+        }
+        w->sum_squares += power / channels;
+        w->sum_weighted += weighted;
+        w->peak = peak > w->peak ? peak : w->peak;
+        w->samples++;
+    }
+}
+
+static void decode_audio(AudioAnalysis *a, AVPacket *pPacket, AVFrame *pFrame) {
+    int response = avcodec_send_packet(a->pCodecContext, pPacket);
+    if (response < 0 && response != AVERROR_EOF) {
+        logging("audio: error while sending a packet to the decoder: %s", av_err2str(response));
+        return; // a broken packet only costs its own samples
+    }
+    while ((response = avcodec_receive_frame(a->pCodecContext, pFrame)) >= 0)
+        process_frame(a, pFrame);
+    if (response != AVERROR(EAGAIN) && response != AVERROR_EOF)
+        logging("audio: error while receiving a frame from the decoder: %s", av_err2str(response));
+}
+
+static void *audio_thread(void *arg) {
+    AudioAnalysis *a = arg;
+    AVFrame *pFrame = av_frame_alloc();
+    AVPacket *pPacket;
+
+    while ((pPacket = spsc_queue_pop(&a->packets))) {
+        if (pFrame && !a->failed)
+            decode_audio(a, pPacket, pFrame);
+        av_packet_free(&pPacket);
+    }
+    if (pFrame && !a->failed)
+        decode_audio(a, NULL, pFrame); // drain
+    else
+        a->failed = 1;
+
+    av_frame_free(&pFrame);
+    return NULL;
+}
+
+AudioAnalysis *audio_analysis_start(AVFormatContext *pFormatContext, int video_stream_index) {
+    const AVCodec *pCodec = NULL;
+    int index = av_find_best_stream(pFormatContext, AVMEDIA_TYPE_AUDIO, -1, video_stream_index, &pCodec, 0);
+    if (index < 0) {
+        logging("no audio stream to analyse");
+        return NULL;
+    }
+
+    AudioAnalysis *a = calloc(1, sizeof(*a));
+    if (!a)
+        return NULL;
+    AVStream *audio_stream = pFormatContext->streams[index];
+    AVStream *video_stream = pFormatContext->streams[video_stream_index];
+
+    a->pCodecContext = avcodec_alloc_context3(pCodec);
+    if (!a->pCodecContext || avcodec_parameters_to_context(a->pCodecContext, audio_stream->codecpar) < 0 ||
+        avcodec_open2(a->pCodecContext, pCodec, NULL) < 0) {
+        logging("failed to open the audio decoder");
+        avcodec_free_context(&a->pCodecContext);
+        free(a);
+        return NULL;
+    }
+    if (a->pCodecContext->channels > AUDIO_MAX_CHANNELS)
+        logging("audio: only the first %d of %d channels are analysed", AUDIO_MAX_CHANNELS, a->pCodecContext->channels);
+
+    // one window per video frame, window 0 starting with the first frame
+    AVRational rate = video_stream->avg_frame_rate.num ? video_stream->avg_frame_rate : video_stream->r_frame_rate;
+    a->window_sec = rate.num > 0 && rate.den > 0 ? av_q2d((AVRational){ rate.den, rate.num }) : 1 / 25.0;
+    a->video_start_sec = video_stream->start_time != AV_NOPTS_VALUE ? video_stream->start_time * av_q2d(video_stream->time_base) : 0;
+    a->samples_per_window = a->window_sec * a->pCodecContext->sample_rate;
+    a->stream_index = index;
+    a->time_base = audio_stream->time_base;
+    k_weighting_init(a, a->pCodecContext->sample_rate);
+
+    if (spsc_queue_init(&a->packets, AUDIO_PACKET_QUEUE_SIZE) < 0) {
+        avcodec_free_context(&a->pCodecContext);
+        free(a);
+        return NULL;
+    }
+    if (pthread_create(&a->thread, NULL, audio_thread, a) != 0) {
+        logging("failed to start the audio thread");
+        spsc_queue_destroy(&a->packets);
+        avcodec_free_context(&a->pCodecContext);
+        free(a);
+        return NULL;
+    }
+    logging("audio: analysing stream %d (%s, %d Hz), %.1f ms windows", index, pCodec->name,
+            a->pCodecContext->sample_rate, a->window_sec * 1000);
+    return a;
+}
+
+int audio_analysis_stream_index(const AudioAnalysis *audio) {
+    return audio->stream_index;
+}
+
+int audio_analysis_send(AudioAnalysis *audio, AVPacket *pPacket) {
+    if (spsc_queue_push(&audio->packets, pPacket) < 0) {
+        av_packet_free(&pPacket);
+        return -1;
+    }
+    return 0;
+}
+
+static double to_db(double power) {
+    return power > 0 ? 10 * log10(power) : -INFINITY;
+}
+
+/**
+ * @brief
+ * Momentary loudness (LUFS) of the 400 ms ending with window i
+ */
+static double momentary_loudness(const AudioAnalysis *a, size_t i) {
+    size_t span = FFMAX(1, lrint(AUDIO_MOMENTARY_SEC / a->window_sec)); // windows longer than 400 ms: just the last one
+    double weighted = 0;
+    int64_t samples = 0;
+    for (size_t j = i + 1 > span ? i + 1 - span : 0; j <= i; j++) {
+        weighted += a->windows[j].sum_weighted;
+        samples += a->windows[j].samples;
+    }
+    return samples ? -0.691 + to_db(weighted / samples) : -INFINITY;
+}
+
+/**
+ * @brief
+ * Gated integrated loudness over the momentary blocks
+ */
+static double integrated_loudness(const AudioAnalysis *a, const double *momentary) {
+    double threshold = AUDIO_ABSOLUTE_GATE;
+    for (int pass = 0; pass < 2; pass++) {
+        double sum = 0;
+        size_t n = 0;
+        for (size_t i = 0; i < a->nb_windows; i++) {
+            if (momentary[i] > threshold) {
+                sum += pow(10, (momentary[i] + 0.691) / 10);
+                n++;
+            }
+        }
+        if (!n)
+            return -INFINITY;
+        double loudness = -0.691 + to_db(sum / n);
+        if (pass == 1)
+            return loudness;
+        threshold = loudness + AUDIO_RELATIVE_GATE;
+    }
+    return -INFINITY;
+}
+
+static void write_json_number(FILE *f, double value) {
+    if (isfinite(value))
+        fprintf(f, "%.2f", value);
+    else
+        fprintf(f, "null");
+}
+
+static int write_loudness(const AudioAnalysis *a, const double *momentary, const char *prefix) {
+    char filename[1024];
+    snprintf(filename, sizeof(filename), "%s-loudness.json", prefix);
+    FILE *f = fopen(filename, "w");
+    if (!f) {
+        logging("could not open %s", filename);
+        return -1;
+    }
+
+    fprintf(f, "{\n  \"window_seconds\": %.6f,\n  \"integrated_lufs\": ", a->window_sec);
+    write_json_number(f, integrated_loudness(a, momentary));
+    fprintf(f, ",\n  \"windows\": [");
+    for (size_t i = 0; i < a->nb_windows; i++) {
+        const AudioWindow *w = &a->windows[i];
+        fprintf(f, "%s\n    { \"frame\": %zu, \"time\": %.3f, \"rms_db\": ", i ? "," : "", i + 1, i * a->window_sec);
+        write_json_number(f, w->samples ? to_db(w->sum_squares / w->samples) : -INFINITY);
+        fprintf(f, ", \"peak_db\": ");
+        write_json_number(f, 2 * to_db(w->peak));
+        fprintf(f, ", \"momentary_lufs\": ");
+        write_json_number(f, momentary[i]);
+        fprintf(f, " }");
+    }
+    fprintf(f, "%s]\n}\n", a->nb_windows ? "\n  " : "");
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+/**
+ * @brief
+ * Waveform image: peak envelope in gray, RMS in white, one band of columns
+ * per window so the bands line up with the extracted frames
+ */
+static int write_waveform(const AudioAnalysis *a, const char *prefix) {
+    int band = a->nb_windows && a->nb_windows < WAVEFORM_WIDTH ? WAVEFORM_WIDTH / (int)a->nb_windows : 1;
+    int width = a->nb_windows ? (int)a->nb_windows * band : 1;
+    uint8_t *image = calloc((size_t)width, WAVEFORM_HEIGHT);
+    if (!image)
+        return -1;
+
+    const int mid = WAVEFORM_HEIGHT / 2;
+    for (size_t i = 0; i < a->nb_windows; i++) {
+        const AudioWindow *w = &a->windows[i];
+        // float decoders go past full scale: clip to the image
+        int peak = (int)lrint(FFMIN(w->peak, 1.0) * (mid - 1));
+        int rms = w->samples ? (int)lrint(FFMIN(sqrt(w->sum_squares / w->samples), 1.0) * (mid - 1)) : 0;
+        for (int x = (int)i * band; x < ((int)i + 1) * band; x++) {
+            for (int y = mid - peak; y <= mid + peak; y++)
+                image[y * width + x] = 160;
+            for (int y = mid - rms; y <= mid + rms; y++)
+                image[y * width + x] = 255;
+        }
+        if (band >= 4) // frame boundary
+            for (int y = 0; y < WAVEFORM_HEIGHT; y += 2)
+                image[y * width + (int)i * band] = 64;
+    }
+
+    char filename[1024];
+    snprintf(filename, sizeof(filename), "%s-waveform.pgm", prefix);
+    FILE *f = fopen(filename, "w");
+    int ret = -1;
+    if (f) {
+        fprintf(f, "P5\n%d %d\n%d\n", width, WAVEFORM_HEIGHT, 255);
+        ret = fwrite(image, 1, (size_t)width * WAVEFORM_HEIGHT, f) == (size_t)width * WAVEFORM_HEIGHT ? 0 : -1;
+        if (fclose(f) != 0)
+            ret = -1;
+    }
+    if (ret < 0)
+        logging("could not write %s", filename);
+    free(image);
+    return ret;
+}
+
+int audio_analysis_finish(AudioAnalysis *audio, const char *prefix) {
+    if (!audio)
+        return 0;
+
+    spsc_queue_close(&audio->packets);
+    pthread_join(audio->thread, NULL);
+
+    int ret = audio->failed ? -1 : 0;
+    double *momentary = malloc((audio->nb_windows ? audio->nb_windows : 1) * sizeof(*momentary));
+    if (ret == 0 && momentary) {
+        for (size_t i = 0; i < audio->nb_windows; i++)
+            momentary[i] = momentary_loudness(audio, i);
+        if (write_loudness(audio, momentary, prefix) < 0 || write_waveform(audio, prefix) < 0)
+            ret = -1;
+        else
+            logging("audio: %zu windows written to %s-loudness.json and %s-waveform.pgm", audio->nb_windows, prefix, prefix);
+    } else {
+        logging("audio analysis failed");
+        ret = -1;
+    }
+
+    free(momentary);
+    free(audio->windows);
+    spsc_queue_destroy(&audio->packets);
+    avcodec_free_context(&audio->pCodecContext);
+    free(audio);
+    return ret;
+}
@@ -0,0 +1,63 @@
+/**
+ * @file audio.h
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Audio loudness and waveform summary computed in the same demux pass as the
+ * frame extraction. The demuxer hands the packets of the audio stream over to
+ * a thread that decodes them and accumulates, per window of one video frame
+ * duration, the RMS level, the sample peak and a K-weighted momentary
+ * loudness (ITU-R BS.1770 style, LUFS). The result is written as JSON and as
+ * a small waveform image whose columns line up with the video frames.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef A3_AUDIO_H
+#define A3_AUDIO_H
+
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+
+typedef struct AudioAnalysis AudioAnalysis;
+
+/**
+ * @brief
+ * Open the decoder of the first audio stream and start the analysis thread
+ * @param pFormatContext opened input
+ * @param video_stream_index the windows follow the frame rate and start time of this stream
+ * @return AudioAnalysis* or NULL if there is no usable audio stream
+ */
+AudioAnalysis *audio_analysis_start(AVFormatContext *pFormatContext, int video_stream_index);
+
+/**
+ * @brief
+ * Index of the analysed stream, to route packets from the demux loop
+ * @param audio
+ * @return int
+ */
+int audio_analysis_stream_index(const AudioAnalysis *audio);
+
+/**
+ * @brief
+ * Queue a packet of the audio stream for the analysis thread
+ * @param audio
+ * @param pPacket taken over, even on failure
+ * @return int 0 on success, <0 on failure
+ */
+int audio_analysis_send(AudioAnalysis *audio, AVPacket *pPacket);
+
+/**
+ * @brief
+ * End of input: drain the decoder, write <prefix>-loudness.json and
+ * <prefix>-waveform.pgm, and free everything
+ * @param audio
+ * @param prefix e.g. "audio"
+ * @return int 0 on success, -1 on failure
+ */
+int audio_analysis_finish(AudioAnalysis *audio, const char *prefix);
+
+#endif
@@ -0,0 +1,84 @@
+#!/bin/sh
+#
+# bench.sh - time A3 builds on the extraction workload
+#
+#   sh bench/bench.sh BIN [BIN...] -- INPUT [A3 ARGS...]
+#   sh bench/bench.sh --train BIN INPUT [A3 ARGS...]
+#
+# Every binary is run BENCH_RUNS times (default 20) inside a scratch
+# directory so the extracted frames never land in the source tree. The
+# first binary is the baseline; the others are reported as a speedup over it
+# and the fastest one is named at the end. --train runs a single binary
+# without reporting, which is how `make pgo` collects its profile.
+
+set -e
+
+RUNS=${BENCH_RUNS:-20}
+
+now_ns() {
+    perl -MTime::HiRes=time -e 'printf "%d\n", time * 1e9'
+}
+
+abspath() {
+    case "$1" in
+        /*) echo "$1" ;;
+        *)  echo "$(pwd)/$1" ;;
+    esac
+}
+
+# run_workload BIN INPUT ARGS... -> prints elapsed nanoseconds for RUNS runs
+run_workload() {
+    bin=$1; shift
+    start=$(now_ns)
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        (cd "$SCRATCH" && "$bin" "$@" >/dev/null 2>&1) || {
+            echo "bench: $bin failed on $*" >&2
+            exit 1
+        }
+        i=$((i + 1))
+    done
+    end=$(now_ns)
+    echo $((end - start))
+}
+
+SCRATCH=$(mktemp -d "${TMPDIR:-/tmp}/a3-bench.XXXXXX")
+trap 'rm -rf "$SCRATCH"' EXIT INT TERM
+
+if [ "$1" = "--train" ]; then
+    shift
+    bin=$(abspath "$1"); input=$(abspath "$2"); shift 2
+    run_workload "$bin" "$input" "$@" >/dev/null
+    exit 0
+fi
+
+BINS=""
+while [ $# -gt 0 ] && [ "$1" != "--" ]; do
+    BINS="$BINS $(abspath "$1")"
+    shift
+done
+[ "$1" = "--" ] && shift
+if [ -z "$BINS" ] || [ $# -lt 1 ]; then
+    echo "usage: $0 BIN [BIN...] -- INPUT [A3 ARGS...]" >&2
+    exit 1
+fi
+input=$(abspath "$1"); shift
+
+echo "workload: $input${*:+ $*}, $RUNS runs per binary"
+printf "%-16s %12s %12s %9s\n" binary "total ms" "ms/run" speedup
+
+base=""
+best=""
+best_ns=""
+for bin in $BINS; do
+    run_workload "$bin" "$input" "$@" >/dev/null   # warm the page cache
+    ns=$(run_workload "$bin" "$input" "$@")
+    [ -z "$base" ] && base=$ns
+    if [ -z "$best_ns" ] || [ "$ns" -lt "$best_ns" ]; then
+        best=$bin; best_ns=$ns
+    fi
+    awk -v name="$(basename "$bin")" -v ns="$ns" -v base="$base" -v runs="$RUNS" 'BEGIN {
+        printf "%-16s %12.1f %12.2f %8.2fx\n", name, ns / 1e6, ns / 1e6 / runs, base / ns
+    }'
+done
+echo "fastest: $(basename "$best")"
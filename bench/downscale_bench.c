@@ -0,0 +1,119 @@
+/**
+ * @file downscale_bench.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Benchmark of the grayscale thumbnail path (downscale.h) against swscale's
+ * area filter, the closest swscale has to a box filter: time to reduce one
+ * luma plane by 2, 4 and 8, median of the runs, plus the largest difference
+ * between the two outputs. The box filter writes its rows to a buffer and
+ * the swscale context is created once, so only the filtering is timed. The
+ * source is a synthetic pattern, no input file is needed.
+ *
+ * Usage: bench/downscale_bench [-r runs] [-s WIDTHxHEIGHT]
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "../downscale.h"
+
+#include <libavutil/common.h>
+#include <libswscale/swscale.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double *times, int runs) {
+    qsort(times, runs, sizeof(*times), compare_double);
+    return times[runs / 2];
+}
+
+int main(int argc, char **argv) {
+    int runs = 31, width = 3840, height = 2160, opt;
+    while ((opt = getopt(argc, argv, "r:s:")) != -1) {
+        if (opt == 'r') {
+            runs = atoi(optarg) > 0 ? atoi(optarg) : 1;
+        } else if (opt == 's' && sscanf(optarg, "%dx%d", &width, &height) == 2 && width > 0 && height > 0) {
+            continue;
+        } else {
+            fprintf(stderr, "usage: %s [-r runs] [-s WIDTHxHEIGHT]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // a padded plane, as decoders hand them out
+    int linesize = (width + 63) & ~63;
+    uint8_t *src = malloc((size_t)linesize * height);
+    uint8_t *box = malloc((size_t)width * height);
+    uint8_t *area = malloc((size_t)width * height);
+    uint16_t *sums = malloc(width * sizeof(*sums));
+    double *times = calloc(runs, sizeof(*times));
+    if (!src || !box || !area || !sums || !times) {
+        fprintf(stderr, "could not allocate a %dx%d plane\n", width, height);
+        return 1;
+    }
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            src[y * linesize + x] = (uint8_t)((x ^ y) + (x * y >> 7));
+
+    printf("gray8 %dx%d\n", width, height);
+    for (int factor = 2; factor <= DOWNSCALE_MAX_FACTOR; factor *= 2) {
+        int out_width = width / factor, out_height = height / factor; // whole blocks, as the area filter sees them
+        struct SwsContext *ctx = sws_getContext(out_width * factor, out_height * factor, AV_PIX_FMT_GRAY8, out_width, out_height,
+                                                AV_PIX_FMT_GRAY8, SWS_AREA, NULL, NULL, NULL);
+        if (!ctx) {
+            fprintf(stderr, "swscale cannot reduce by %d\n", factor);
+            return 1;
+        }
+
+        for (int run = 0; run < runs; run++) {
+            double start = now_sec();
+            for (int y = 0; y < out_height; y++)
+                downscale_box_row(src + (size_t)y * factor * linesize, linesize, out_width * factor, factor, factor, sums,
+                                  box + (size_t)y * out_width);
+            times[run] = now_sec() - start;
+        }
+        double box_time = median(times, runs);
+
+        const uint8_t *src_planes[4] = { src };
+        const int src_linesizes[4] = { linesize };
+        uint8_t *dst_planes[4] = { area };
+        const int dst_linesizes[4] = { out_width };
+        for (int run = 0; run < runs; run++) {
+            double start = now_sec();
+            sws_scale(ctx, src_planes, src_linesizes, 0, out_height * factor, dst_planes, dst_linesizes);
+            times[run] = now_sec() - start;
+        }
+        double area_time = median(times, runs);
+        sws_freeContext(ctx);
+
+        int max_diff = 0;
+        for (int i = 0; i < out_width * out_height; i++)
+            max_diff = FFMAX(max_diff, abs(box[i] - area[i]));
+        printf("  /%d %5dx%-5d  box %7.3f ms  area %7.3f ms  x%.2f  max diff %d\n", factor, out_width, out_height,
+               box_time * 1e3, area_time * 1e3, box_time > 0 ? area_time / box_time : 0, max_diff);
+    }
+
+    free(src);
+    free(box);
+    free(area);
+    free(sums);
+    free(times);
+    return 0;
+}
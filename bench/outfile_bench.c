@@ -0,0 +1,113 @@
+/**
+ * @file outfile_bench.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Benchmark of the write modes of outfile.h on PPM-sized files, from a
+ * thumbnail to 4K: time to create, fill and close one file, median of the
+ * runs. The fill stands in for the colour conversion: every byte of the
+ * content is written once, row by row, into the buffer the mode provides.
+ * The files go to a scratch directory (default: the current directory) and
+ * are removed again; the page cache is not dropped between runs, as in a
+ * real extraction.
+ *
+ * Usage: bench/outfile_bench [-r runs] [-d directory]
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "../outfile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief
+ * A P6 image written in place, as save_ppm() does
+ */
+static int write_ppm(const char *filename, int width, int height, int seed) {
+    char header[32];
+    int header_size = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+    size_t row_size = (size_t)width * 3, size = header_size + row_size * height;
+    OutFile file;
+    if (outfile_open(&file, filename, size) < 0)
+        return -1;
+
+    memcpy(file.data, header, header_size);
+    for (int y = 0; y < height; y++) {
+        uint8_t *row = file.data + header_size + y * row_size;
+        for (size_t x = 0; x < row_size; x++)
+            row[x] = (uint8_t)(x + y + seed);
+    }
+    return outfile_close(&file, size);
+}
+
+typedef struct Size {
+    const char *name;
+    int width, height;
+} Size;
+
+int main(int argc, char **argv) {
+    const char *directory = ".";
+    int runs = 25, opt;
+    while ((opt = getopt(argc, argv, "r:d:")) != -1) {
+        if (opt == 'r') {
+            runs = atoi(optarg) > 0 ? atoi(optarg) : 1;
+        } else if (opt == 'd') {
+            directory = optarg;
+        } else {
+            fprintf(stderr, "usage: %s [-r runs] [-d directory]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    const Size sizes[] = { { "160x90", 160, 90 }, { "640x360", 640, 360 }, { "1080p", 1920, 1080 }, { "4K", 3840, 2160 } };
+    const WriteMode modes[] = { WRITE_MODE_BUFFERED, WRITE_MODE_MMAP };
+    const char *mode_names[] = { "buffered", "mmap" };
+    double *times = calloc(runs, sizeof(*times));
+    char filename[1024];
+    if (!times)
+        return 1;
+    snprintf(filename, sizeof(filename), "%s/outfile_bench-%d.ppm", directory, (int)getpid());
+
+    printf("PPM files in %s, median of %d\n", directory, runs);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        double bytes = (double)sizes[s].width * sizes[s].height * 3;
+        for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+            outfile_set_mode(modes[m]);
+            for (int run = 0; run < runs; run++) {
+                unlink(filename);
+                double start = now_sec();
+                if (write_ppm(filename, sizes[s].width, sizes[s].height, run) < 0) {
+                    perror(filename);
+                    return 1;
+                }
+                times[run] = now_sec() - start;
+            }
+            qsort(times, runs, sizeof(*times), compare_double);
+            double median = times[runs / 2];
+            printf("  %-8s %-8s %9.3f ms  %8.1f MB/s\n", sizes[s].name, mode_names[m], median * 1e3,
+                   median > 0 ? bytes / median / 1e6 : 0);
+        }
+    }
+    unlink(filename);
+    free(times);
+    return 0;
+}
@@ -0,0 +1,217 @@
+/**
+ * @file pagecache_bench.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Benchmark of what a backfill's outputs do to a concurrent read workload,
+ * for the write modes of outfile.h. A "hot" file stands for the input
+ * videos or another service's data: it is read into the page cache, then a
+ * reader thread keeps reading random 1 MiB blocks of it, one every
+ * millisecond, while the main thread writes 4K PPM-sized files. Reported
+ * per mode:
+ *
+ *   write     throughput of the writer
+ *   read p50/p99  latency of the reader's blocks during the writes
+ *   hot       share of the hot file still in the page cache afterwards
+ *   cached    share of the written outputs left in the page cache
+ *
+ * The outputs only evict the hot file once they outgrow the free memory:
+ * pass -o larger than MemAvailable to see it, the cached column shows the
+ * pressure building up either way.
+ *
+ * Usage: bench/pagecache_bench [-d directory] [-i hot_MiB] [-o output_MiB]
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "../outfile.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BLOCK_SIZE (1 << 20)
+#define MAX_READS 1000000
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief
+ * Share of the pages of a file in the page cache, from mincore(2)
+ */
+static double cached_share(const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    off_t size = fd >= 0 ? lseek(fd, 0, SEEK_END) : 0;
+    if (size <= 0) {
+        if (fd >= 0)
+            close(fd);
+        return 0;
+    }
+    long page = sysconf(_SC_PAGESIZE);
+    size_t pages = (size + page - 1) / page, resident = 0;
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    unsigned char *vec = malloc(pages);
+    if (map != MAP_FAILED && vec && mincore(map, size, vec) == 0) {
+        for (size_t i = 0; i < pages; i++)
+            resident += vec[i] & 1;
+    }
+    free(vec);
+    if (map != MAP_FAILED)
+        munmap(map, size);
+    close(fd);
+    return (double)resident / pages;
+}
+
+typedef struct Reader {
+    int fd;
+    size_t blocks;
+    atomic_int stop;
+    double *latencies;
+    int nb_reads;
+} Reader;
+
+static void *reader_thread(void *arg) {
+    Reader *reader = arg;
+    unsigned seed = 1;
+    char *block = malloc(BLOCK_SIZE);
+    while (block && !atomic_load(&reader->stop) && reader->nb_reads < MAX_READS) {
+        off_t offset = (off_t)(rand_r(&seed) % reader->blocks) * BLOCK_SIZE;
+        double start = now_sec();
+        if (pread(reader->fd, block, BLOCK_SIZE, offset) < 0)
+            break;
+        reader->latencies[reader->nb_reads++] = now_sec() - start;
+        usleep(1000);
+    }
+    free(block);
+    return NULL;
+}
+
+/**
+ * @brief
+ * A P6 image written in place, as save_ppm() does
+ */
+static int write_ppm(const char *filename, int width, int height, int seed) {
+    char header[32];
+    int header_size = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+    size_t row_size = (size_t)width * 3, size = header_size + row_size * height;
+    OutFile file;
+    if (outfile_open(&file, filename, size) < 0)
+        return -1;
+
+    memcpy(file.data, header, header_size);
+    for (int y = 0; y < height; y++)
+        memset(file.data + header_size + y * row_size, (uint8_t)(y + seed), row_size);
+    return outfile_close(&file, size);
+}
+
+/**
+ * @brief
+ * Write or read the whole hot file, so that it starts fully cached
+ */
+static int prepare_hot_file(const char *filename, size_t blocks) {
+    char *block = malloc(BLOCK_SIZE);
+    int fd = block ? open(filename, O_RDWR | O_CREAT, 0644) : -1;
+    int ret = fd >= 0 ? 0 : -1;
+    if (ret == 0 && lseek(fd, 0, SEEK_END) != (off_t)(blocks * BLOCK_SIZE)) {
+        memset(block, 'h', BLOCK_SIZE);
+        for (size_t i = 0; i < blocks && ret == 0; i++)
+            ret = pwrite(fd, block, BLOCK_SIZE, (off_t)i * BLOCK_SIZE) == BLOCK_SIZE ? 0 : -1;
+    }
+    for (size_t i = 0; i < blocks && ret == 0; i++)
+        ret = pread(fd, block, BLOCK_SIZE, (off_t)i * BLOCK_SIZE) < 0 ? -1 : 0;
+    if (fd >= 0)
+        close(fd);
+    free(block);
+    return ret;
+}
+
+int main(int argc, char **argv) {
+    const char *directory = ".";
+    int hot_mib = 256, output_mib = 1024, opt;
+    while ((opt = getopt(argc, argv, "d:i:o:")) != -1) {
+        if (opt == 'd') {
+            directory = optarg;
+        } else if (opt == 'i' && atoi(optarg) > 0) {
+            hot_mib = atoi(optarg);
+        } else if (opt == 'o' && atoi(optarg) > 0) {
+            output_mib = atoi(optarg);
+        } else {
+            fprintf(stderr, "usage: %s [-d directory] [-i hot_MiB] [-o output_MiB]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    const int width = 3840, height = 2160;
+    const double file_size = (double)width * height * 3;
+    const int nb_files = (int)((double)output_mib * (1 << 20) / file_size) + 1;
+    const WriteMode modes[] = { WRITE_MODE_BUFFERED, WRITE_MODE_DONTNEED, WRITE_MODE_DIRECT };
+    const char *mode_names[] = { "buffered", "dontneed", "direct" };
+    char hot[1024], filename[1024];
+    snprintf(hot, sizeof(hot), "%s/pagecache_bench-%d.hot", directory, (int)getpid());
+
+    Reader reader = { .blocks = hot_mib, .latencies = malloc(MAX_READS * sizeof(double)) };
+    if (!reader.latencies)
+        return 1;
+
+    printf("%d MiB hot file, %d 4K PPM files (%.0f MiB) per mode, in %s\n", hot_mib, nb_files,
+           nb_files * file_size / (1 << 20), directory);
+    printf("  %-9s %10s %12s %12s %7s %7s\n", "mode", "write MB/s", "read p50 ms", "read p99 ms", "hot", "cached");
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        if (prepare_hot_file(hot, reader.blocks) < 0 || (reader.fd = open(hot, O_RDONLY)) < 0) {
+            perror(hot);
+            return 1;
+        }
+        pthread_t thread;
+        atomic_init(&reader.stop, 0);
+        reader.nb_reads = 0;
+        if (pthread_create(&thread, NULL, reader_thread, &reader) != 0)
+            return 1;
+
+        outfile_set_mode(modes[m]);
+        double start = now_sec();
+        for (int i = 0; i < nb_files; i++) {
+            snprintf(filename, sizeof(filename), "%s/pagecache_bench-%d-%d.ppm", directory, (int)getpid(), i);
+            if (write_ppm(filename, width, height, i) < 0) {
+                perror(filename);
+                return 1;
+            }
+        }
+        double elapsed = now_sec() - start;
+        atomic_store(&reader.stop, 1);
+        pthread_join(thread, NULL);
+        close(reader.fd);
+
+        double cached = 0;
+        for (int i = 0; i < nb_files; i++) {
+            snprintf(filename, sizeof(filename), "%s/pagecache_bench-%d-%d.ppm", directory, (int)getpid(), i);
+            cached += cached_share(filename) / nb_files;
+            unlink(filename);
+        }
+        qsort(reader.latencies, reader.nb_reads, sizeof(double), compare_double);
+        double p50 = reader.nb_reads ? reader.latencies[reader.nb_reads / 2] : 0;
+        double p99 = reader.nb_reads ? reader.latencies[reader.nb_reads * 99 / 100] : 0;
+        printf("  %-9s %10.1f %12.3f %12.3f %6.1f%% %6.1f%%\n", mode_names[m], nb_files * file_size / elapsed / 1e6,
+               p50 * 1e3, p99 * 1e3, cached_share(hot) * 100, cached * 100);
+    }
+    unlink(hot);
+    free(reader.latencies);
+    return 0;
+}
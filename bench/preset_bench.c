@@ -0,0 +1,133 @@
+/**
+ * @file preset_bench.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Benchmark of the decode presets (extract.h): frames/s of each preset and
+ * the luma PSNR of its frames against the exact decode of the same input.
+ *
+ * Usage: bench/preset_bench [-r runs] media_file...
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "../extract.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief
+ * Decode every frame of input with preset
+ * @return double seconds, <0 on failure
+ */
+static double decode_all(const char *input, DecodePreset preset, long *frames) {
+    ExtractContext extract = { .video_stream_index = -1, .preset = preset };
+    if (extract_open(&extract, input) < 0)
+        return -1;
+    AVFrame *pFrame = av_frame_alloc();
+    if (!pFrame) {
+        extract_close(&extract);
+        return -1;
+    }
+
+    double start = now_sec();
+    *frames = 0;
+    while (extract_next_frame(&extract, pFrame) == 0)
+        ++*frames;
+    double elapsed = now_sec() - start;
+
+    av_frame_free(&pFrame);
+    extract_close(&extract);
+    return elapsed;
+}
+
+/**
+ * @brief
+ * Decode input with preset and with the exact preset side by side
+ * @return double luma PSNR in dB, INFINITY if identical, NAN on failure
+ */
+static double luma_psnr(const char *input, DecodePreset preset) {
+    ExtractContext exact = { .video_stream_index = -1, .preset = DECODE_PRESET_EXACT };
+    ExtractContext test = { .video_stream_index = -1, .preset = preset };
+    AVFrame *ref = av_frame_alloc(), *frame = av_frame_alloc();
+    double sse = 0, pixels = 0;
+
+    if (ref && frame && extract_open(&exact, input) == 0 && extract_open(&test, input) == 0) {
+        while (extract_next_frame(&exact, ref) == 0 && extract_next_frame(&test, frame) == 0) {
+            if (ref->width != frame->width || ref->height != frame->height)
+                break;
+            for (int y = 0; y < ref->height; y++) {
+                const uint8_t *a = ref->data[0] + y * ref->linesize[0];
+                const uint8_t *b = frame->data[0] + y * frame->linesize[0];
+                for (int x = 0; x < ref->width; x++) {
+                    int d = a[x] - b[x];
+                    sse += d * d;
+                }
+            }
+            pixels += (double)ref->width * ref->height;
+        }
+    }
+
+    av_frame_free(&ref);
+    av_frame_free(&frame);
+    extract_close(&exact);
+    extract_close(&test);
+    if (pixels == 0)
+        return NAN;
+    return sse == 0 ? INFINITY : 10 * log10(255.0 * 255.0 * pixels / sse);
+}
+
+int main(int argc, char **argv) {
+    int runs = 3, opt;
+    while ((opt = getopt(argc, argv, "r:")) != -1) {
+        if (opt != 'r') {
+            fprintf(stderr, "usage: %s [-r runs] media_file...\n", argv[0]);
+            return 1;
+        }
+        runs = atoi(optarg) > 0 ? atoi(optarg) : 1;
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "usage: %s [-r runs] media_file...\n", argv[0]);
+        return 1;
+    }
+
+    for (int i = optind; i < argc; i++) {
+        double exact_fps = 0;
+        printf("%s\n", argv[i]);
+        for (DecodePreset preset = DECODE_PRESET_EXACT; preset <= DECODE_PRESET_FASTEST; preset++) {
+            // best of runs, the first run also warms the page cache
+            double best = INFINITY;
+            long frames = 0;
+            for (int run = 0; run < runs; run++) {
+                double elapsed = decode_all(argv[i], preset, &frames);
+                if (elapsed < 0) {
+                    fprintf(stderr, "%s: could not decode\n", argv[i]);
+                    return 1;
+                }
+                if (elapsed < best)
+                    best = elapsed;
+            }
+            double fps = best > 0 ? frames / best : 0;
+            if (preset == DECODE_PRESET_EXACT)
+                exact_fps = fps;
+
+            double psnr = preset == DECODE_PRESET_EXACT ? INFINITY : luma_psnr(argv[i], preset);
+            printf("  %-8s %6ld frames  %9.1f frames/s  x%.2f  PSNR(Y) %6.2f dB\n", decode_preset_name(preset),
+                   frames, fps, exact_fps > 0 ? fps / exact_fps : 0, psnr);
+        }
+    }
+    return 0;
+}
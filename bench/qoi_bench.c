@@ -0,0 +1,171 @@
+/**
+ * @file qoi_bench.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Benchmark of the RGB output formats on decoded frames: size and encode
+ * speed of PPM, QOI (qoi.h) and PNG (FFmpeg's encoder). Every format encodes
+ * to memory, so disk speed is left out. MB/s counts raw RGB24 input bytes.
+ *
+ * Usage: bench/qoi_bench [-r runs] [-n frames] media_file...
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "../convert.h"
+#include "../extract.h"
+#include "../qoi.h"
+
+#include <libavcodec/avcodec.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief
+ * Decode up to max_frames frames of input and convert them to RGB24
+ * @return int number of frames stored in rgb
+ */
+static int load_rgb_frames(const char *input, AVFrame **rgb, int max_frames) {
+    ExtractContext extract = { .video_stream_index = -1 };
+    AVFrame *pFrame = av_frame_alloc();
+    int count = 0;
+
+    if (pFrame && extract_open(&extract, input) == 0) {
+        while (count < max_frames && extract_next_frame(&extract, pFrame) == 0) {
+            AVFrame *frame = av_frame_alloc();
+            if (!frame)
+                break;
+            frame->width = pFrame->width;
+            frame->height = pFrame->height;
+            frame->format = AV_PIX_FMT_RGB24;
+            if (av_frame_get_buffer(frame, 0) < 0 || convert_frame(pFrame, frame) < 0) {
+                av_frame_free(&frame);
+                break;
+            }
+            rgb[count++] = frame;
+        }
+        extract_close(&extract);
+    }
+    av_frame_free(&pFrame);
+    return count;
+}
+
+static size_t encode_ppm(const AVFrame *frame, uint8_t *out) {
+    size_t size = sprintf((char *)out, "P6\n%d %d\n255\n", frame->width, frame->height);
+    for (int y = 0; y < frame->height; y++) {
+        memcpy(out + size, frame->data[0] + y * frame->linesize[0], frame->width * 3);
+        size += frame->width * 3;
+    }
+    return size;
+}
+
+static size_t encode_qoi(const AVFrame *frame, uint8_t *out) {
+    return qoi_encode_rgb(frame->data[0], frame->linesize[0], frame->width, frame->height, out);
+}
+
+static AVCodecContext *png_context;
+static AVPacket *png_packet;
+
+static size_t encode_png(const AVFrame *frame, uint8_t *out) {
+    size_t size = 0;
+    if (avcodec_send_frame(png_context, frame) < 0)
+        return 0;
+    while (avcodec_receive_packet(png_context, png_packet) == 0) {
+        memcpy(out + size, png_packet->data, png_packet->size);
+        size += png_packet->size;
+        av_packet_unref(png_packet);
+    }
+    return size;
+}
+
+static int open_png(int width, int height) {
+    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_PNG);
+    if (!codec || !(png_context = avcodec_alloc_context3(codec)) || !(png_packet = av_packet_alloc()))
+        return -1;
+    png_context->width = width;
+    png_context->height = height;
+    png_context->pix_fmt = AV_PIX_FMT_RGB24;
+    png_context->time_base = (AVRational){ 1, 25 };
+    return avcodec_open2(png_context, codec, NULL);
+}
+
+typedef struct Format {
+    const char *name;
+    size_t (*encode)(const AVFrame *frame, uint8_t *out);
+} Format;
+
+int main(int argc, char **argv) {
+    int runs = 3, max_frames = 30, opt;
+    while ((opt = getopt(argc, argv, "r:n:")) != -1) {
+        if (opt == 'r') {
+            runs = atoi(optarg) > 0 ? atoi(optarg) : 1;
+        } else if (opt == 'n') {
+            max_frames = atoi(optarg) > 0 ? atoi(optarg) : 1;
+        } else {
+            fprintf(stderr, "usage: %s [-r runs] [-n frames] media_file...\n", argv[0]);
+            return 1;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "usage: %s [-r runs] [-n frames] media_file...\n", argv[0]);
+        return 1;
+    }
+
+    const Format formats[] = { { "ppm", encode_ppm }, { "qoi", encode_qoi }, { "png", encode_png } };
+    AVFrame **rgb = calloc(max_frames, sizeof(*rgb));
+    if (!rgb)
+        return 1;
+
+    for (int i = optind; i < argc; i++) {
+        int count = load_rgb_frames(argv[i], rgb, max_frames);
+        if (count == 0) {
+            fprintf(stderr, "%s: no frame could be decoded and converted\n", argv[i]);
+            return 1;
+        }
+        int width = rgb[0]->width, height = rgb[0]->height;
+        double raw_bytes = (double)width * height * 3 * count;
+        uint8_t *out = malloc(qoi_max_size(width, height) + 1024); // also fits a PPM or a PNG of stored blocks
+        if (!out || open_png(width, height) < 0) {
+            fprintf(stderr, "could not set up the encoders\n");
+            return 1;
+        }
+
+        printf("%s: %d frames %dx%d\n", argv[i], count, width, height);
+        for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+            double best = INFINITY, bytes = 0;
+            for (int run = 0; run < runs; run++) {
+                bytes = 0;
+                double start = now_sec();
+                for (int k = 0; k < count; k++)
+                    bytes += formats[f].encode(rgb[k], out);
+                double elapsed = now_sec() - start;
+                if (elapsed < best)
+                    best = elapsed;
+            }
+            printf("  %-4s %10.0f bytes/frame  %5.1f%% of raw  %8.1f MB/s\n", formats[f].name, bytes / count,
+                   100 * bytes / raw_bytes, best > 0 ? raw_bytes / best / 1e6 : 0);
+        }
+
+        free(out);
+        avcodec_free_context(&png_context);
+        av_packet_free(&png_packet);
+        for (int k = 0; k < count; k++)
+            av_frame_free(&rgb[k]);
+    }
+    free(rgb);
+    return 0;
+}
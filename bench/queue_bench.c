@@ -0,0 +1,245 @@
+/**
+ * @file queue_bench.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Microbenchmark of the pipeline handoff queues (queue.h) against the
+ * mutex + condition variable handoff they replace:
+ *
+ *   - throughput: items/s through SPSC (1 -> 1) and MPMC (P -> C) rings
+ *   - latency: one-way handoff latency from a ping-pong over two queues
+ *
+ * Usage: bench/queue_bench [items] [producers] [consumers]
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "../queue.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_CAPACITY 256
+#define PING_ROUNDS 100000
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* ------------------------------------------- mutex + condvar baseline */
+
+typedef struct LockedQueue {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty, not_full;
+    void **slots;
+    size_t cap, head, size;
+    int closed;
+} LockedQueue;
+
+static void locked_init(LockedQueue *q, size_t cap) {
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+    pthread_cond_init(&q->not_full, NULL);
+    q->slots = calloc(cap, sizeof(*q->slots));
+    q->cap = cap;
+    q->head = q->size = 0;
+    q->closed = 0;
+}
+
+static void locked_push(LockedQueue *q, void *item) {
+    pthread_mutex_lock(&q->lock);
+    while (q->size == q->cap)
+        pthread_cond_wait(&q->not_full, &q->lock);
+    q->slots[(q->head + q->size++) % q->cap] = item;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static void *locked_pop(LockedQueue *q) {
+    void *item = NULL;
+    pthread_mutex_lock(&q->lock);
+    while (q->size == 0 && !q->closed)
+        pthread_cond_wait(&q->not_empty, &q->lock);
+    if (q->size) {
+        item = q->slots[q->head];
+        q->head = (q->head + 1) % q->cap;
+        q->size--;
+        pthread_cond_signal(&q->not_full);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return item;
+}
+
+static void locked_close(LockedQueue *q) {
+    pthread_mutex_lock(&q->lock);
+    q->closed = 1;
+    pthread_cond_broadcast(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static void locked_destroy(LockedQueue *q) {
+    free(q->slots);
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->not_empty);
+    pthread_cond_destroy(&q->not_full);
+}
+
+/* ------------------------------------------------ generic queue vtable */
+
+typedef struct QueueOps {
+    const char *name;
+    void *queue;
+    void (*push)(void *q, void *item);
+    void *(*pop)(void *q);
+    void (*close)(void *q);
+} QueueOps;
+
+static void spsc_push_op(void *q, void *item) { spsc_queue_push(q, item); }
+static void *spsc_pop_op(void *q) { return spsc_queue_pop(q); }
+static void spsc_close_op(void *q) { spsc_queue_close(q); }
+static void mpmc_push_op(void *q, void *item) { mpmc_queue_push(q, item); }
+static void *mpmc_pop_op(void *q) { return mpmc_queue_pop(q); }
+static void mpmc_close_op(void *q) { mpmc_queue_close(q); }
+static void locked_push_op(void *q, void *item) { locked_push(q, item); }
+static void *locked_pop_op(void *q) { return locked_pop(q); }
+static void locked_close_op(void *q) { locked_close(q); }
+
+/* ---------------------------------------------------------- throughput */
+
+typedef struct ThroughputArgs {
+    const QueueOps *ops;
+    size_t items;
+} ThroughputArgs;
+
+static void *producer(void *arg) {
+    ThroughputArgs *a = arg;
+    for (uintptr_t i = 1; i <= a->items; i++)
+        a->ops->push(a->ops->queue, (void *)i);
+    return NULL;
+}
+
+static void *consumer(void *arg) {
+    ThroughputArgs *a = arg;
+    while (a->ops->pop(a->ops->queue))
+        ;
+    return NULL;
+}
+
+static void bench_throughput(const QueueOps *ops, size_t items, int producers, int consumers) {
+    pthread_t threads[64];
+    ThroughputArgs args = { ops, items / producers };
+    double start = now_sec();
+
+    for (int i = 0; i < consumers; i++)
+        pthread_create(&threads[producers + i], NULL, consumer, &args);
+    for (int i = 0; i < producers; i++)
+        pthread_create(&threads[i], NULL, producer, &args);
+    for (int i = 0; i < producers; i++)
+        pthread_join(threads[i], NULL);
+    ops->close(ops->queue);
+    for (int i = 0; i < consumers; i++)
+        pthread_join(threads[producers + i], NULL);
+
+    double elapsed = now_sec() - start;
+    printf("%-22s %d->%d  %10.2f Mitems/s  %8.1f ns/item\n", ops->name, producers, consumers,
+           args.items * producers / elapsed / 1e6, elapsed * 1e9 / (args.items * producers));
+}
+
+/* ------------------------------------------------------------- latency */
+
+typedef struct PingArgs {
+    const QueueOps *ping, *pong;
+} PingArgs;
+
+static void *ponger(void *arg) {
+    PingArgs *a = arg;
+    void *item;
+    while ((item = a->ping->pop(a->ping->queue)))
+        a->pong->push(a->pong->queue, item);
+    return NULL;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_latency(const char *name, const QueueOps *ping, const QueueOps *pong) {
+    static double samples[PING_ROUNDS];
+    PingArgs args = { ping, pong };
+    pthread_t thread;
+
+    pthread_create(&thread, NULL, ponger, &args);
+    for (uintptr_t i = 1; i <= PING_ROUNDS; i++) {
+        double start = now_sec();
+        ping->push(ping->queue, (void *)i);
+        pong->pop(pong->queue);
+        samples[i - 1] = (now_sec() - start) / 2; // one-way
+    }
+    ping->close(ping->queue);
+    pthread_join(thread, NULL);
+
+    qsort(samples, PING_ROUNDS, sizeof(double), cmp_double);
+    printf("%-22s handoff latency  p50 %8.0f ns  p99 %8.0f ns  p99.9 %8.0f ns\n", name,
+           samples[PING_ROUNDS / 2] * 1e9, samples[PING_ROUNDS * 99 / 100] * 1e9,
+           samples[PING_ROUNDS * 999 / 1000] * 1e9);
+}
+
+int main(int argc, char **argv) {
+    size_t items = argc > 1 ? strtoul(argv[1], NULL, 10) : 4000000;
+    int producers = argc > 2 ? atoi(argv[2]) : 2;
+    int consumers = argc > 3 ? atoi(argv[3]) : 4;
+    if (producers < 1 || consumers < 1 || producers + consumers > 64) {
+        fprintf(stderr, "usage: %s [items] [producers] [consumers]\n", argv[0]);
+        return 1;
+    }
+
+    SpscQueue spsc, spsc_back;
+    MpmcQueue mpmc;
+    LockedQueue locked, locked_back;
+
+    spsc_queue_init(&spsc, BENCH_CAPACITY);
+    QueueOps spsc_ops = { "spsc", &spsc, spsc_push_op, spsc_pop_op, spsc_close_op };
+    bench_throughput(&spsc_ops, items, 1, 1);
+    spsc_queue_destroy(&spsc);
+
+    locked_init(&locked, BENCH_CAPACITY);
+    QueueOps locked_ops = { "mutex+condvar", &locked, locked_push_op, locked_pop_op, locked_close_op };
+    bench_throughput(&locked_ops, items, 1, 1);
+    locked_destroy(&locked);
+
+    mpmc_queue_init(&mpmc, BENCH_CAPACITY);
+    QueueOps mpmc_ops = { "mpmc", &mpmc, mpmc_push_op, mpmc_pop_op, mpmc_close_op };
+    bench_throughput(&mpmc_ops, items, producers, consumers);
+    mpmc_queue_destroy(&mpmc);
+
+    locked_init(&locked, BENCH_CAPACITY);
+    bench_throughput(&locked_ops, items, producers, consumers);
+    locked_destroy(&locked);
+
+    spsc_queue_init(&spsc, BENCH_CAPACITY);
+    spsc_queue_init(&spsc_back, BENCH_CAPACITY);
+    QueueOps ping = { "spsc", &spsc, spsc_push_op, spsc_pop_op, spsc_close_op };
+    QueueOps pong = { "spsc", &spsc_back, spsc_push_op, spsc_pop_op, spsc_close_op };
+    bench_latency("spsc", &ping, &pong);
+    spsc_queue_destroy(&spsc);
+    spsc_queue_destroy(&spsc_back);
+
+    locked_init(&locked, BENCH_CAPACITY);
+    locked_init(&locked_back, BENCH_CAPACITY);
+    QueueOps lping = { "mutex+condvar", &locked, locked_push_op, locked_pop_op, locked_close_op };
+    QueueOps lpong = { "mutex+condvar", &locked_back, locked_push_op, locked_pop_op, locked_close_op };
+    bench_latency("mutex+condvar", &lping, &lpong);
+    locked_destroy(&locked);
+    locked_destroy(&locked_back);
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+/**
+ * @file slice_bench.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Benchmark of the band-parallel colour conversion (slice.h): latency of one
+ * yuv420p to RGB24 conversion against the number of bands, with the built-in
+ * kernel and with per-band swscale. The source is a synthetic gradient, so no
+ * input file is needed. Times are the median of the runs.
+ *
+ * Usage: bench/slice_bench [-r runs] [-s WIDTHxHEIGHT]
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "../slice.h"
+
+#include <libswscale/swscale.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static AVFrame *alloc_frame(int width, int height, enum AVPixelFormat format) {
+    AVFrame *frame = av_frame_alloc();
+    if (!frame)
+        return NULL;
+    frame->width = width;
+    frame->height = height;
+    frame->format = format;
+    if (av_frame_get_buffer(frame, 0) < 0)
+        av_frame_free(&frame);
+    return frame;
+}
+
+/**
+ * @brief
+ * Diagonal gradients in all three planes, so no kernel shortcut applies
+ */
+static void fill_pattern(AVFrame *frame) {
+    for (int y = 0; y < frame->height; y++)
+        for (int x = 0; x < frame->width; x++)
+            frame->data[0][y * frame->linesize[0] + x] = (uint8_t)(x + y);
+    for (int y = 0; y < frame->height / 2; y++) {
+        for (int x = 0; x < frame->width / 2; x++) {
+            frame->data[1][y * frame->linesize[1] + x] = (uint8_t)(x * 2);
+            frame->data[2][y * frame->linesize[2] + x] = (uint8_t)(255 - y * 2);
+        }
+    }
+}
+
+static int convert_kernel(const AVFrame *src, AVFrame *dst, int nb_bands) {
+    return slice_convert_frame(src, dst, nb_bands);
+}
+
+static int convert_swscale(const AVFrame *src, AVFrame *dst, int nb_bands) {
+    return slice_scale_frame(src, dst, nb_bands, SWS_FAST_BILINEAR | SWS_FULL_CHR_H_INT | SWS_ACCURATE_RND);
+}
+
+typedef struct Method {
+    const char *name;
+    int (*convert)(const AVFrame *src, AVFrame *dst, int nb_bands);
+} Method;
+
+int main(int argc, char **argv) {
+    int runs = 15, width = 7680, height = 4320, opt;
+    while ((opt = getopt(argc, argv, "r:s:")) != -1) {
+        if (opt == 'r') {
+            runs = atoi(optarg) > 0 ? atoi(optarg) : 1;
+        } else if (opt == 's' && sscanf(optarg, "%dx%d", &width, &height) == 2 && width > 0 && height > 0) {
+            continue;
+        } else {
+            fprintf(stderr, "usage: %s [-r runs] [-s WIDTHxHEIGHT]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    AVFrame *src = alloc_frame(width, height, AV_PIX_FMT_YUV420P);
+    AVFrame *dst = alloc_frame(width, height, AV_PIX_FMT_RGB24);
+    double *times = calloc(runs, sizeof(*times));
+    if (!src || !dst || !times) {
+        fprintf(stderr, "could not allocate a %dx%d frame\n", width, height);
+        return 1;
+    }
+    fill_pattern(src);
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    const Method methods[] = { { "kernel", convert_kernel }, { "swscale", convert_swscale } };
+    printf("yuv420p -> rgb24 %dx%d, %ld cores, auto = %d bands\n", width, height, cores, slice_auto_bands(width, height));
+
+    for (size_t m = 0; m < sizeof(methods) / sizeof(methods[0]); m++) {
+        double single = 0;
+        for (int nb_bands = 1; nb_bands <= 2 * cores || nb_bands == 1; nb_bands *= 2) {
+            if (methods[m].convert(src, dst, nb_bands) < 0) { // also warms the pool and the caches
+                printf("  %-7s not available for this format pair\n", methods[m].name);
+                break;
+            }
+            for (int run = 0; run < runs; run++) {
+                double start = now_sec();
+                methods[m].convert(src, dst, nb_bands);
+                times[run] = now_sec() - start;
+            }
+            qsort(times, runs, sizeof(*times), compare_double);
+            double median = times[runs / 2];
+            if (nb_bands == 1)
+                single = median;
+            printf("  %-7s %3d bands  %8.2f ms  x%.2f\n", methods[m].name, nb_bands, median * 1e3,
+                   median > 0 ? single / median : 0);
+        }
+    }
+
+    free(times);
+    av_frame_free(&src);
+    av_frame_free(&dst);
+    return 0;
+}
@@ -0,0 +1,346 @@
+/**
+ * @file soak_bench.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Soak test of the extraction core: the inputs are extracted over and over
+ * in one process, as one long concatenated input, for hours. Every input is
+ * opened, decoded to the end, saved through writer.c and closed again, so
+ * leaks in any of these steps pile up. Every interval the process samples:
+ *
+ *   fps       frames extracted per second in the interval
+ *   rss       resident set size, MiB
+ *   fds       open file descriptors
+ *   p50/p99   per-frame latency of each stage, ms: demux (reading the
+ *             packets of a frame), decode (sending them and receiving the
+ *             frame), write (the .pgm and RGB images)
+ *
+ * one CSV line per sample on stdout. The first sample after the warm-up is
+ * the baseline. The run fails, with a "# FAIL" line and exit status 1, as
+ * soon as the RSS grows by more than -R MiB or the descriptors by more than
+ * -F over it, or when a stage's p99 is more than -L times the baseline, or
+ * the throughput below (1 - -T) of it, for -n samples in a row: latency and
+ * throughput are noisy, leaks are not. Exit status 0 after -d seconds
+ * without a failure.
+ *
+ * The images go to a scratch directory (default: a new one in $TMPDIR),
+ * reusing SOAK_FILES names so that the disk does not fill up.
+ *
+ * Usage: bench/soak_bench [-d seconds] [-i interval] [-w warmup] [-o directory]
+ *                         [-R MiB] [-F fds] [-L factor] [-T drop] [-n samples] media_file...
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "../extract.h"
+#include "../writer.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+/** image file names reused in the scratch directory */
+#define SOAK_FILES 64
+
+enum { STAGE_DEMUX, STAGE_DECODE, STAGE_WRITE, NB_STAGES };
+static const char *const stage_names[NB_STAGES] = { "demux", "decode", "write" };
+
+/** latencies of one stage in the current interval, seconds */
+typedef struct Samples {
+    double *values;
+    int count, capacity;
+} Samples;
+
+typedef struct Sample {
+    double fps;
+    double rss_mib;
+    int fds;
+    double p50[NB_STAGES], p99[NB_STAGES];
+} Sample;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void samples_add(Samples *samples, double value) {
+    if (samples->count == samples->capacity) {
+        int capacity = samples->capacity ? samples->capacity * 2 : 4096;
+        double *values = realloc(samples->values, capacity * sizeof(*values));
+        if (!values)
+            return; // the sample is lost, not the run
+        samples->values = values;
+        samples->capacity = capacity;
+    }
+    samples->values[samples->count++] = value;
+}
+
+static double samples_percentile(Samples *samples, int percent) {
+    if (samples->count == 0)
+        return 0;
+    qsort(samples->values, samples->count, sizeof(double), compare_double);
+    return samples->values[(samples->count - 1) * percent / 100];
+}
+
+static double rss_mib(void) {
+    long pages = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f) {
+        int ok = fscanf(f, "%*s %ld", &pages) == 1;
+        fclose(f);
+        if (ok)
+            return (double)pages * sysconf(_SC_PAGESIZE) / (1 << 20);
+    }
+    // no procfs: the peak is all there is, still enough to see a leak
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / (double)(1 << 20);
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+}
+
+static int open_fds(void) {
+    int count = 0;
+    DIR *dir = opendir("/proc/self/fd");
+    if (dir) {
+        for (struct dirent *entry; (entry = readdir(dir));)
+            count += entry->d_name[0] != '.';
+        closedir(dir);
+        return count - 1; // the directory's own descriptor
+    }
+    long max = sysconf(_SC_OPEN_MAX);
+    for (int fd = 0; fd < (max > 0 && max < 65536 ? max : 65536); fd++)
+        count += fcntl(fd, F_GETFD) != -1;
+    return count;
+}
+
+/**
+ * @brief
+ * extract_next_frame(), with the time spent in the demuxer and in the decoder added to times
+ */
+static int next_frame_timed(ExtractContext *ctx, AVFrame *pFrame, double *times) {
+    for (;;) {
+        double start = now_sec();
+        int response = avcodec_receive_frame(ctx->pCodecContext, pFrame);
+        times[STAGE_DECODE] += now_sec() - start;
+        if (response >= 0)
+            extract_frame_properties(ctx, pFrame);
+        if (response != AVERROR(EAGAIN))
+            return response;
+        if (ctx->draining)
+            return AVERROR_EOF;
+
+        start = now_sec();
+        do {
+            av_packet_unref(ctx->pPacket);
+            response = av_read_frame(ctx->pFormatContext, ctx->pPacket);
+        } while (response >= 0 && ctx->pPacket->stream_index != ctx->video_stream_index);
+        double read = now_sec();
+        times[STAGE_DEMUX] += read - start;
+
+        if (response < 0) {
+            ctx->draining = 1;
+            response = avcodec_send_packet(ctx->pCodecContext, NULL);
+        } else {
+            response = avcodec_send_packet(ctx->pCodecContext, ctx->pPacket);
+            av_packet_unref(ctx->pPacket);
+        }
+        times[STAGE_DECODE] += now_sec() - read;
+        if (response < 0 && response != AVERROR_EOF)
+            return response;
+    }
+}
+
+/**
+ * @brief
+ * Compare a sample with the baseline
+ * @return const char* what drifted, NULL if nothing did; the latency and
+ * throughput checks only count after limit samples in a row, tracked in streak
+ */
+static const char *check_drift(const Sample *sample, const Sample *base, double rss_growth, int fd_growth,
+                               double latency_factor, double throughput_drop, int limit, int *streak, char *reason, size_t size) {
+    if (sample->rss_mib > base->rss_mib + rss_growth) {
+        snprintf(reason, size, "rss grew from %.1f to %.1f MiB", base->rss_mib, sample->rss_mib);
+        return reason;
+    }
+    if (sample->fds > base->fds + fd_growth) {
+        snprintf(reason, size, "open descriptors grew from %d to %d", base->fds, sample->fds);
+        return reason;
+    }
+
+    reason[0] = '\0';
+    for (int s = 0; s < NB_STAGES; s++) {
+        if (base->p99[s] > 0 && sample->p99[s] > latency_factor * base->p99[s]) {
+            snprintf(reason, size, "%s p99 %.3f ms against %.3f ms", stage_names[s], sample->p99[s] * 1e3, base->p99[s] * 1e3);
+            break;
+        }
+    }
+    if (!reason[0] && sample->fps < (1 - throughput_drop) * base->fps)
+        snprintf(reason, size, "throughput %.1f fps against %.1f fps", sample->fps, base->fps);
+    *streak = reason[0] ? *streak + 1 : 0;
+    return *streak >= limit ? reason : NULL;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-d seconds] [-i interval] [-w warmup] [-o directory] "
+                    "[-R MiB] [-F fds] [-L factor] [-T drop] [-n samples] media_file...\n", name);
+}
+
+int main(int argc, char **argv) {
+    double duration = 4 * 3600, interval = 10, warmup = 60;
+    double rss_growth = 64, latency_factor = 3, throughput_drop = 0.25;
+    int fd_growth = 4, limit = 3, opt;
+    const char *directory = NULL;
+    while ((opt = getopt(argc, argv, "d:i:w:o:R:F:L:T:n:")) != -1) {
+        switch (opt) {
+        case 'd':
+            duration = atof(optarg);
+            break;
+        case 'i':
+            interval = atof(optarg);
+            break;
+        case 'w':
+            warmup = atof(optarg);
+            break;
+        case 'o':
+            directory = optarg;
+            break;
+        case 'R':
+            rss_growth = atof(optarg);
+            break;
+        case 'F':
+            fd_growth = atoi(optarg);
+            break;
+        case 'L':
+            latency_factor = atof(optarg);
+            break;
+        case 'T':
+            throughput_drop = atof(optarg);
+            break;
+        case 'n':
+            limit = atoi(optarg) > 0 ? atoi(optarg) : 1;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind >= argc || interval <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    char scratch[1024], prefix[1100];
+    if (!directory) {
+        const char *tmp = getenv("TMPDIR");
+        snprintf(scratch, sizeof(scratch), "%s/a3-soak.XXXXXX", tmp ? tmp : "/tmp");
+        if (!mkdtemp(scratch)) {
+            perror(scratch);
+            return 1;
+        }
+        directory = scratch;
+    }
+    snprintf(prefix, sizeof(prefix), "%s/frame", directory);
+
+    AVFrame *pFrame = av_frame_alloc();
+    Samples latencies[NB_STAGES] = { { 0 } };
+    Sample base = { 0 };
+    int have_base = 0, streak = 0, failed = 0, input = optind, fnumber = 0, window_frames = 0;
+    long long total_frames = 0;
+    char reason[256];
+    if (!pFrame)
+        return 1;
+
+    printf("# %d inputs, images in %s, %g s, sample every %g s after %g s of warm-up\n", argc - optind, directory, duration, interval, warmup);
+    printf("elapsed_s,frames,fps,rss_mib,fds");
+    for (int s = 0; s < NB_STAGES; s++)
+        printf(",%s_p50_ms,%s_p99_ms", stage_names[s], stage_names[s]);
+    printf("\n");
+    fflush(stdout);
+
+    double start = now_sec(), window_start = start;
+    while (!failed && now_sec() - start < duration) {
+        ExtractContext extract = { .video_stream_index = -1 };
+        if (extract_open(&extract, argv[input]) < 0) {
+            printf("# FAIL could not open %s\n", argv[input]);
+            failed = 1;
+            break;
+        }
+        input = input + 1 < argc ? input + 1 : optind;
+
+        for (;;) {
+            double times[NB_STAGES] = { 0 };
+            int response = next_frame_timed(&extract, pFrame, times);
+            if (response == AVERROR_EOF)
+                break;
+            if (response < 0) {
+                printf("# FAIL decoding: %s\n", av_err2str(response));
+                failed = 1;
+                break;
+            }
+
+            double write_start = now_sec();
+            fnumber = fnumber % SOAK_FILES + 1;
+            save_gray_frame(pFrame->data[0], pFrame->linesize[0], pFrame->width, pFrame->height, prefix, fnumber);
+            save_rgb_frame(pFrame, prefix, fnumber);
+            times[STAGE_WRITE] = now_sec() - write_start;
+            for (int s = 0; s < NB_STAGES; s++)
+                samples_add(&latencies[s], times[s]);
+            window_frames++;
+            total_frames++;
+
+            double now = now_sec();
+            if (now - window_start < interval)
+                continue;
+            Sample sample = { .fps = window_frames / (now - window_start), .rss_mib = rss_mib(), .fds = open_fds() };
+            for (int s = 0; s < NB_STAGES; s++) {
+                sample.p50[s] = samples_percentile(&latencies[s], 50);
+                sample.p99[s] = samples_percentile(&latencies[s], 99);
+                latencies[s].count = 0;
+            }
+            printf("%.0f,%lld,%.1f,%.1f,%d", now - start, total_frames, sample.fps, sample.rss_mib, sample.fds);
+            for (int s = 0; s < NB_STAGES; s++)
+                printf(",%.3f,%.3f", sample.p50[s] * 1e3, sample.p99[s] * 1e3);
+            printf("\n");
+
+            if (!have_base && now - start >= warmup) {
+                base = sample;
+                have_base = 1;
+                printf("# baseline\n");
+            } else if (have_base && check_drift(&sample, &base, rss_growth, fd_growth, latency_factor, throughput_drop,
+                                                limit, &streak, reason, sizeof(reason))) {
+                printf("# FAIL %s\n", reason);
+                failed = 1;
+            }
+            fflush(stdout);
+            window_frames = 0;
+            window_start = now;
+            if (failed || now - start >= duration)
+                break;
+        }
+        extract_close(&extract);
+    }
+
+    if (!failed)
+        printf("# PASS %lld frames in %.0f s\n", total_frames, now_sec() - start);
+    av_frame_free(&pFrame);
+    for (int s = 0; s < NB_STAGES; s++)
+        free(latencies[s].values);
+    return failed;
+}
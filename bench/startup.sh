@@ -0,0 +1,84 @@
+#!/bin/sh
+#
+# startup.sh - binary size and time to first frame of A3 builds
+#
+#   sh bench/startup.sh BIN [BIN...] -- INPUT
+#
+# A short job is dominated by what happens before the first frame: loading
+# the binary and its shared libraries, registering codecs, probing the input
+# and decoding one frame. Every binary extracts the frame at 0 s (-t 0)
+# BENCH_RUNS times (default 50) in a scratch directory and the median wall
+# time is reported, along with the file size and the number of shared
+# libraries it loads. The first binary is the baseline.
+
+set -e
+
+RUNS=${BENCH_RUNS:-50}
+
+# time_ns CMD... -> wall nanoseconds of CMD, without the cost of starting the timer;
+# the output of CMD is discarded
+time_ns() {
+    perl -MTime::HiRes=time -e 'open(my $out, ">&", \*STDOUT); open(STDOUT, ">", "/dev/null");
+        $s = time; system(@ARGV) == 0 or exit 1; printf $out "%d\n", (time - $s) * 1e9' "$@"
+}
+
+abspath() {
+    case "$1" in
+        /*) echo "$1" ;;
+        *)  echo "$(pwd)/$1" ;;
+    esac
+}
+
+# nb_shared_libs BIN -> shared libraries resolved by the dynamic loader
+nb_shared_libs() {
+    if command -v ldd >/dev/null 2>&1; then
+        ldd "$1" 2>/dev/null | grep -c '=>' || true
+    elif command -v otool >/dev/null 2>&1; then
+        otool -L "$1" | tail -n +2 | wc -l | tr -d ' '
+    else
+        echo "?"
+    fi
+}
+
+# first_frame_ns BIN INPUT -> median nanoseconds of RUNS single-frame jobs
+first_frame_ns() {
+    : > "$SCRATCH/times"
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        (cd "$SCRATCH" && time_ns "$1" -t 0 "$2" 2>/dev/null >> times) || {
+            echo "startup: $1 failed on $2" >&2
+            exit 1
+        }
+        i=$((i + 1))
+    done
+    sort -n "$SCRATCH/times" | awk '{ t[NR] = $1 } END { print t[int((NR + 1) / 2)] }'
+}
+
+SCRATCH=$(mktemp -d "${TMPDIR:-/tmp}/a3-startup.XXXXXX")
+trap 'rm -rf "$SCRATCH"' EXIT INT TERM
+
+BINS=""
+while [ $# -gt 0 ] && [ "$1" != "--" ]; do
+    BINS="$BINS $(abspath "$1")"
+    shift
+done
+[ "$1" = "--" ] && shift
+if [ -z "$BINS" ] || [ $# -ne 1 ]; then
+    echo "usage: $0 BIN [BIN...] -- INPUT" >&2
+    exit 1
+fi
+input=$(abspath "$1")
+
+echo "first frame of $input, median of $RUNS runs"
+printf "%-16s %12s %8s %14s %9s\n" binary "size KiB" "shlibs" "first frame ms" speedup
+
+base=""
+for bin in $BINS; do
+    first_frame_ns "$bin" "$input" >/dev/null   # warm the page cache
+    ns=$(first_frame_ns "$bin" "$input")
+    [ -z "$base" ] && base=$ns
+    size=$(wc -c < "$bin")
+    awk -v name="$(basename "$bin")" -v size="$size" -v libs="$(nb_shared_libs "$bin")" -v ns="$ns" -v base="$base" 'BEGIN {
+        printf "%-16s %12.0f %8s %14.2f %8.2fx\n", name, size / 1024, libs, ns / 1e6, base / ns
+    }'
+done
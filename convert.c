@@ -0,0 +1,341 @@
+/**
+ * @file convert.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Compile-time specialized YUV -> RGB24/BGR24/GRAY8 kernels and the table
+ * mapping AVPixelFormat pairs onto them. See convert.h.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include <libavutil/display.h>
+#include <libavutil/mathematics.h>
+
+#include "convert.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** source rows converted per strip by convert_frame_geometry(), even for 4:2:0 */
+#define CONVERT_STRIP_ROWS 16
+
+/*
+ * Q14 coefficient tables. Limited range scales luma by 255/219 and chroma
+ * by 255/224; full range (JPEG) uses the plain matrix.
+ */
+static const YuvCoeffs coeffs_bt601_limited = { 16, 19077, 26149,  -6419, -13320, 33050 };
+static const YuvCoeffs coeffs_bt601_full    = {  0, 16384, 22970,  -5638, -11700, 29032 };
+static const YuvCoeffs coeffs_bt709_limited = { 16, 19077, 29372,  -3494,  -8731, 34610 };
+static const YuvCoeffs coeffs_bt709_full    = {  0, 16384, 25802,  -3069,  -7670, 30402 };
+
+static inline uint8_t clip_uint8(int v) {
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+/**
+ * @brief
+ * Generate a planar YUV -> packed RGB kernel.
+ *
+ * SUB_W/SUB_H are log2 of the chroma subsampling, PIXEL/DEPTH the sample
+ * type and bit depth, RI/GI/BI the byte order of the output pixel. The inner
+ * loop walks one chroma sample at a time and emits its 1 << SUB_W luma pixels
+ * with a constant trip count, so the compiler unrolls it completely; only an
+ * odd trailing column is handled separately, once per row.
+ */
+#define DEFINE_YUV_TO_RGB(NAME, SUB_W, SUB_H, PIXEL, DEPTH, RI, GI, BI)              \
+static void NAME(const uint8_t *const src[4], const int src_stride[4],              \
+                 uint8_t *dst, int dst_stride, int width, int height,               \
+                 const YuvCoeffs *c)                                                \
+{                                                                                   \
+    enum { SHIFT = CONVERT_COEFF_BITS + (DEPTH) - 8, STEP = 1 << (SUB_W) };         \
+    const int y_off  = c->y_offset << ((DEPTH) - 8);                                \
+    const int uv_off = 128 << ((DEPTH) - 8);                                        \
+    const int y_mul = c->y_mul, v_to_r = c->v_to_r, u_to_g = c->u_to_g;             \
+    const int v_to_g = c->v_to_g, u_to_b = c->u_to_b;                               \
+    const int round = 1 << (SHIFT - 1);                                             \
+                                                                                    \
+    for (int y = 0; y < height; y++) {                                              \
+        const PIXEL *py = (const PIXEL *)(src[0] + y * src_stride[0]);              \
+        const PIXEL *pu = (const PIXEL *)(src[1] + (y >> (SUB_H)) * src_stride[1]); \
+        const PIXEL *pv = (const PIXEL *)(src[2] + (y >> (SUB_H)) * src_stride[2]); \
+        uint8_t *out = dst + y * dst_stride;                                        \
+        int x = 0;                                                                  \
+                                                                                    \
+        for (; x + STEP <= width; x += STEP) {                                      \
+            const int u = *pu++ - uv_off, v = *pv++ - uv_off;                       \
+            const int r = v_to_r * v + round;                                       \
+            const int g = u_to_g * u + v_to_g * v + round;                          \
+            const int b = u_to_b * u + round;                                       \
+            for (int k = 0; k < STEP; k++) {                                        \
+                const int l = (py[x + k] - y_off) * y_mul;                          \
+                out[RI] = clip_uint8((l + r) >> SHIFT);                             \
+                out[GI] = clip_uint8((l + g) >> SHIFT);                             \
+                out[BI] = clip_uint8((l + b) >> SHIFT);                             \
+                out += 3;                                                           \
+            }                                                                       \
+        }                                                                           \
+        if (x < width) {                                                            \
+            const int u = *pu - uv_off, v = *pv - uv_off;                           \
+            const int r = v_to_r * v + round;                                       \
+            const int g = u_to_g * u + v_to_g * v + round;                          \
+            const int b = u_to_b * u + round;                                       \
+            for (; x < width; x++) {                                                \
+                const int l = (py[x] - y_off) * y_mul;                              \
+                out[RI] = clip_uint8((l + r) >> SHIFT);                             \
+                out[GI] = clip_uint8((l + g) >> SHIFT);                             \
+                out[BI] = clip_uint8((l + b) >> SHIFT);                             \
+                out += 3;                                                           \
+            }                                                                       \
+        }                                                                           \
+    }                                                                               \
+}
+
+/**
+ * @brief
+ * Generate a luma-only kernel: plane 0 reduced to 8 bits, as in the PGM output.
+ */
+#define DEFINE_YUV_TO_GRAY(NAME, PIXEL, DEPTH)                                      \
+static void NAME(const uint8_t *const src[4], const int src_stride[4],              \
+                 uint8_t *dst, int dst_stride, int width, int height,               \
+                 const YuvCoeffs *c)                                                \
+{                                                                                   \
+    (void)c;                                                                        \
+    for (int y = 0; y < height; y++) {                                              \
+        const PIXEL *py = (const PIXEL *)(src[0] + y * src_stride[0]);              \
+        uint8_t *out = dst + y * dst_stride;                                        \
+        if ((DEPTH) == 8) {                                                         \
+            memcpy(out, py, width);                                                 \
+        } else {                                                                    \
+            for (int x = 0; x < width; x++)                                         \
+                out[x] = py[x] >> ((DEPTH) - 8);                                    \
+        }                                                                           \
+    }                                                                               \
+}
+
+DEFINE_YUV_TO_RGB(yuv420p_to_rgb24,      1, 1, uint8_t,  8, 0, 1, 2)
+DEFINE_YUV_TO_RGB(yuv422p_to_rgb24,      1, 0, uint8_t,  8, 0, 1, 2)
+DEFINE_YUV_TO_RGB(yuv444p_to_rgb24,      0, 0, uint8_t,  8, 0, 1, 2)
+DEFINE_YUV_TO_RGB(yuv420p_to_bgr24,      1, 1, uint8_t,  8, 2, 1, 0)
+DEFINE_YUV_TO_RGB(yuv422p_to_bgr24,      1, 0, uint8_t,  8, 2, 1, 0)
+DEFINE_YUV_TO_RGB(yuv444p_to_bgr24,      0, 0, uint8_t,  8, 2, 1, 0)
+DEFINE_YUV_TO_RGB(yuv420p10_to_rgb24,    1, 1, uint16_t, 10, 0, 1, 2)
+DEFINE_YUV_TO_RGB(yuv422p10_to_rgb24,    1, 0, uint16_t, 10, 0, 1, 2)
+DEFINE_YUV_TO_RGB(yuv444p10_to_rgb24,    0, 0, uint16_t, 10, 0, 1, 2)
+DEFINE_YUV_TO_RGB(yuv420p10_to_bgr24,    1, 1, uint16_t, 10, 2, 1, 0)
+DEFINE_YUV_TO_RGB(yuv422p10_to_bgr24,    1, 0, uint16_t, 10, 2, 1, 0)
+DEFINE_YUV_TO_RGB(yuv444p10_to_bgr24,    0, 0, uint16_t, 10, 2, 1, 0)
+DEFINE_YUV_TO_GRAY(yuv8_to_gray8,   uint8_t,  8)
+DEFINE_YUV_TO_GRAY(yuv10_to_gray8,  uint16_t, 10)
+
+static const Converter converters[] = {
+    { AV_PIX_FMT_YUV420P,     AV_PIX_FMT_RGB24, 1, 1, 0, yuv420p_to_rgb24 },
+    { AV_PIX_FMT_YUV422P,     AV_PIX_FMT_RGB24, 1, 0, 0, yuv422p_to_rgb24 },
+    { AV_PIX_FMT_YUV444P,     AV_PIX_FMT_RGB24, 0, 0, 0, yuv444p_to_rgb24 },
+    { AV_PIX_FMT_YUVJ420P,    AV_PIX_FMT_RGB24, 1, 1, 1, yuv420p_to_rgb24 },
+    { AV_PIX_FMT_YUVJ422P,    AV_PIX_FMT_RGB24, 1, 0, 1, yuv422p_to_rgb24 },
+    { AV_PIX_FMT_YUVJ444P,    AV_PIX_FMT_RGB24, 0, 0, 1, yuv444p_to_rgb24 },
+    { AV_PIX_FMT_YUV420P10LE, AV_PIX_FMT_RGB24, 1, 1, 0, yuv420p10_to_rgb24 },
+    { AV_PIX_FMT_YUV422P10LE, AV_PIX_FMT_RGB24, 1, 0, 0, yuv422p10_to_rgb24 },
+    { AV_PIX_FMT_YUV444P10LE, AV_PIX_FMT_RGB24, 0, 0, 0, yuv444p10_to_rgb24 },
+
+    { AV_PIX_FMT_YUV420P,     AV_PIX_FMT_BGR24, 1, 1, 0, yuv420p_to_bgr24 },
+    { AV_PIX_FMT_YUV422P,     AV_PIX_FMT_BGR24, 1, 0, 0, yuv422p_to_bgr24 },
+    { AV_PIX_FMT_YUV444P,     AV_PIX_FMT_BGR24, 0, 0, 0, yuv444p_to_bgr24 },
+    { AV_PIX_FMT_YUVJ420P,    AV_PIX_FMT_BGR24, 1, 1, 1, yuv420p_to_bgr24 },
+    { AV_PIX_FMT_YUVJ422P,    AV_PIX_FMT_BGR24, 1, 0, 1, yuv422p_to_bgr24 },
+    { AV_PIX_FMT_YUVJ444P,    AV_PIX_FMT_BGR24, 0, 0, 1, yuv444p_to_bgr24 },
+    { AV_PIX_FMT_YUV420P10LE, AV_PIX_FMT_BGR24, 1, 1, 0, yuv420p10_to_bgr24 },
+    { AV_PIX_FMT_YUV422P10LE, AV_PIX_FMT_BGR24, 1, 0, 0, yuv422p10_to_bgr24 },
+    { AV_PIX_FMT_YUV444P10LE, AV_PIX_FMT_BGR24, 0, 0, 0, yuv444p10_to_bgr24 },
+
+    { AV_PIX_FMT_YUV420P,     AV_PIX_FMT_GRAY8, 1, 1, 0, yuv8_to_gray8 },
+    { AV_PIX_FMT_YUV422P,     AV_PIX_FMT_GRAY8, 1, 0, 0, yuv8_to_gray8 },
+    { AV_PIX_FMT_YUV444P,     AV_PIX_FMT_GRAY8, 0, 0, 0, yuv8_to_gray8 },
+    { AV_PIX_FMT_YUVJ420P,    AV_PIX_FMT_GRAY8, 1, 1, 1, yuv8_to_gray8 },
+    { AV_PIX_FMT_YUVJ422P,    AV_PIX_FMT_GRAY8, 1, 0, 1, yuv8_to_gray8 },
+    { AV_PIX_FMT_YUVJ444P,    AV_PIX_FMT_GRAY8, 0, 0, 1, yuv8_to_gray8 },
+    { AV_PIX_FMT_YUV420P10LE, AV_PIX_FMT_GRAY8, 1, 1, 0, yuv10_to_gray8 },
+    { AV_PIX_FMT_YUV422P10LE, AV_PIX_FMT_GRAY8, 1, 0, 0, yuv10_to_gray8 },
+    { AV_PIX_FMT_YUV444P10LE, AV_PIX_FMT_GRAY8, 0, 0, 0, yuv10_to_gray8 },
+};
+
+const Converter *converter_find(enum AVPixelFormat src_fmt, enum AVPixelFormat dst_fmt) {
+    for (size_t i = 0; i < sizeof(converters) / sizeof(converters[0]); i++)
+        if (converters[i].src_fmt == src_fmt && converters[i].dst_fmt == dst_fmt)
+            return &converters[i];
+    return NULL;
+}
+
+const YuvCoeffs *converter_coeffs(const Converter *conv, const AVFrame *frame) {
+    int full = conv->full_range || frame->color_range == AVCOL_RANGE_JPEG;
+    // untagged streams: HD sizes are BT.709, everything else (sample.mpg) BT.601
+    int bt709 = frame->colorspace == AVCOL_SPC_BT709 ||
+                (frame->colorspace == AVCOL_SPC_UNSPECIFIED && frame->height > 576);
+
+    if (bt709)
+        return full ? &coeffs_bt709_full : &coeffs_bt709_limited;
+    return full ? &coeffs_bt601_full : &coeffs_bt601_limited;
+}
+
+int convert_frame(const AVFrame *src, AVFrame *dst) {
+    const Converter *conv = converter_find(src->format, dst->format);
+    if (!conv)
+        return -1;
+
+    conv->convert((const uint8_t *const *)src->data, src->linesize, dst->data[0], dst->linesize[0],
+                  src->width, src->height, converter_coeffs(conv, src));
+    return 0;
+}
+
+void frame_geometry(const AVFrame *frame, FrameGeometry *geometry) {
+    AVRational sar = frame->sample_aspect_ratio;
+
+    geometry->scaled_width = frame->width;
+    if (sar.num > 0 && sar.den > 0 && sar.num != sar.den)
+        geometry->scaled_width = FFMAX(1, (int)av_rescale(frame->width, sar.num, sar.den));
+
+    geometry->rotation = 0;
+    AVFrameSideData *sd = av_frame_get_side_data(frame, AV_FRAME_DATA_DISPLAYMATRIX);
+    if (sd && sd->size >= 9 * sizeof(int32_t)) {
+        // the matrix holds the counterclockwise rotation the picture went through
+        double angle = -av_display_rotation_get((const int32_t *)sd->data);
+        if (!isnan(angle))
+            geometry->rotation = ((int)lrint(angle / 90) % 4 + 4) % 4 * 90;
+    }
+
+    if (geometry->rotation == 90 || geometry->rotation == 270) {
+        geometry->width = frame->height;
+        geometry->height = geometry->scaled_width;
+    } else {
+        geometry->width = geometry->scaled_width;
+        geometry->height = frame->height;
+    }
+}
+
+/**
+ * @brief
+ * Horizontal resampling map: output column x interpolates source columns
+ * x0[x] and x0[x] + 1 with weight frac[x] / 256 on the second one
+ */
+typedef struct ResampleMap {
+    int *x0;
+    uint8_t *frac;
+} ResampleMap;
+
+static int resample_map_init(ResampleMap *map, int src_width, int dst_width) {
+    map->x0 = malloc(dst_width * sizeof(*map->x0));
+    map->frac = malloc(dst_width);
+    if (!map->x0 || !map->frac)
+        return -1;
+
+    for (int x = 0; x < dst_width; x++) {
+        // centre of the output pixel in source coordinates, 16.16 fixed point
+        int64_t pos = ((2 * (int64_t)x + 1) * src_width << 16) / (2 * dst_width) - (1 << 15);
+        pos = pos < 0 ? 0 : pos;
+        int x0 = (int)(pos >> 16);
+        int frac = (int)((pos & 0xFFFF) + 128) >> 8;
+        if (x0 >= src_width - 1) {
+            x0 = src_width - 1;
+            frac = 0;
+        } else if (frac == 256) {
+            x0++;
+            frac = 0;
+        }
+        map->x0[x] = x0;
+        map->frac[x] = frac;
+    }
+    return 0;
+}
+
+static inline void resample_pixel(const uint8_t *row, const ResampleMap *map, int x, int bpp, uint8_t *out) {
+    const uint8_t *a = row + map->x0[x] * bpp;
+    const int f = map->frac[x];
+    if (!f) {
+        memcpy(out, a, bpp);
+        return;
+    }
+    for (int k = 0; k < bpp; k++)
+        out[k] = a[k] + (((a[k + bpp] - a[k]) * f + 128) >> 8);
+}
+
+/**
+ * @brief
+ * Resample one converted strip to square pixels and store it rotated. For 90
+ * and 270 degrees the strip is walked column by column, so every destination
+ * row receives a contiguous run of strip-height pixels (a blocked transpose).
+ */
+static void store_strip(const uint8_t *strip, int strip_stride, int y, int rows, int src_height,
+                        const ResampleMap *map, int bpp, AVFrame *dst, const FrameGeometry *g) {
+    const int sw = g->scaled_width;
+    uint8_t *out = dst->data[0];
+    const int stride = dst->linesize[0];
+
+    switch (g->rotation) {
+    case 0:
+    case 180:
+        for (int r = 0; r < rows; r++) {
+            const uint8_t *row = strip + r * strip_stride;
+            if (g->rotation == 0) {
+                uint8_t *line = out + (y + r) * stride;
+                for (int x = 0; x < sw; x++)
+                    resample_pixel(row, map, x, bpp, line + x * bpp);
+            } else {
+                uint8_t *line = out + (src_height - 1 - y - r) * stride;
+                for (int x = 0; x < sw; x++)
+                    resample_pixel(row, map, x, bpp, line + (sw - 1 - x) * bpp);
+            }
+        }
+        break;
+    case 90: // source row y becomes destination column src_height - 1 - y
+        for (int x = 0; x < sw; x++) {
+            uint8_t *line = out + x * stride + (src_height - y - rows) * bpp;
+            for (int r = rows - 1; r >= 0; r--, line += bpp)
+                resample_pixel(strip + r * strip_stride, map, x, bpp, line);
+        }
+        break;
+    case 270: // source row y becomes destination column y, bottom-up
+        for (int x = 0; x < sw; x++) {
+            uint8_t *line = out + (sw - 1 - x) * stride + y * bpp;
+            for (int r = 0; r < rows; r++, line += bpp)
+                resample_pixel(strip + r * strip_stride, map, x, bpp, line);
+        }
+        break;
+    }
+}
+
+int convert_frame_geometry(const AVFrame *src, AVFrame *dst, const FrameGeometry *geometry) {
+    const Converter *conv = converter_find(src->format, dst->format);
+    if (!conv)
+        return -1;
+
+    const int bpp = dst->format == AV_PIX_FMT_GRAY8 ? 1 : 3;
+    const int strip_stride = src->width * bpp;
+    uint8_t *strip = malloc((size_t)CONVERT_STRIP_ROWS * strip_stride);
+    ResampleMap map = { NULL, NULL };
+    int ret = -1;
+
+    if (strip && resample_map_init(&map, src->width, geometry->scaled_width) == 0) {
+        const YuvCoeffs *coeffs = converter_coeffs(conv, src);
+        for (int y = 0; y < src->height; y += CONVERT_STRIP_ROWS) {
+            int rows = FFMIN(CONVERT_STRIP_ROWS, src->height - y);
+            const uint8_t *planes[4] = { src->data[0] + y * src->linesize[0] };
+            for (int p = 1; p < 3; p++)
+                if (src->data[p])
+                    planes[p] = src->data[p] + (y >> conv->log2_chroma_h) * src->linesize[p];
+
+            conv->convert(planes, src->linesize, strip, strip_stride, src->width, rows, coeffs);
+            store_strip(strip, strip_stride, y, rows, src->height, &map, bpp, dst, geometry);
+        }
+        ret = 0;
+    }
+
+    free(strip);
+    free(map.x0);
+    free(map.frac);
+    return ret;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file convert.h
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Specialized pixel format converters used instead of swscale for the
+ * common decoder outputs. Every (source pix_fmt, destination pix_fmt) pair
+ * in the table gets its own kernel, generated at compile time for its
+ * chroma subsampling, bit depth and output layout, so the inner loops carry
+ * no per-pixel format checks. Pairs that are not in the table return NULL
+ * from converter_find() and the caller falls back to swscale.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef A3_CONVERT_H
+#define A3_CONVERT_H
+
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+
+#include <stdint.h>
+
+/** fractional bits of the fixed-point coefficients */
+#define CONVERT_COEFF_BITS 14
+
+/**
+ * @brief
+ * Fixed-point YUV -> RGB matrix (Q14). One constant table exists per
+ * colour matrix and range, see converter_coeffs().
+ */
+typedef struct YuvCoeffs {
+    int y_offset; // black level at 8 bits (16 for limited range, 0 for full range)
+    int y_mul;
+    int v_to_r;
+    int u_to_g;
+    int v_to_g;
+    int u_to_b;
+} YuvCoeffs;
+
+/**
+ * @brief
+ * Converter kernel: convert a width x height picture starting at row 0 of src.
+ * @param src plane pointers of the source picture
+ * @param src_stride line sizes of the source planes
+ * @param dst packed destination
+ * @param dst_stride line size of the destination
+ * @param width
+ * @param height
+ * @param coeffs matrix to use, ignored by the gray kernels
+ */
+typedef void (*ConvertFunc)(const uint8_t *const src[4], const int src_stride[4],
+                            uint8_t *dst, int dst_stride, int width, int height,
+                            const YuvCoeffs *coeffs);
+
+/**
+ * @brief
+ * One entry of the runtime dispatch table.
+ */
+typedef struct Converter {
+    enum AVPixelFormat src_fmt;
+    enum AVPixelFormat dst_fmt;
+    int log2_chroma_w;
+    int log2_chroma_h;
+    int full_range;  // the source format implies full range (YUVJ formats)
+    ConvertFunc convert;
+} Converter;
+
+/**
+ * @brief
+ * Look up the specialized kernel for a format pair
+ * @param src_fmt
+ * @param dst_fmt
+ * @return const Converter* or NULL when the pair has no specialization
+ */
+const Converter *converter_find(enum AVPixelFormat src_fmt, enum AVPixelFormat dst_fmt);
+
+/**
+ * @brief
+ * Pick the coefficient table matching the frame's colour matrix and range
+ * @param conv converter selected for the frame
+ * @param frame
+ * @return const YuvCoeffs*
+ */
+const YuvCoeffs *converter_coeffs(const Converter *conv, const AVFrame *frame);
+
+/**
+ * @brief
+ * Convert src into the already allocated dst with a specialized kernel
+ * @param src
+ * @param dst destination frame, dst->format selects the output layout
+ * @return int 0 on success, -1 when no kernel exists for the pair
+ */
+int convert_frame(const AVFrame *src, AVFrame *dst);
+
+/**
+ * @brief
+ * Output geometry of a frame shown the way it is meant to be seen: square
+ * pixels (sample aspect ratio applied) and upright (display matrix applied).
+ */
+typedef struct FrameGeometry {
+    int width;        // output size, rotation included
+    int height;
+    int scaled_width; // source width in square pixels, before rotation
+    int rotation;     // clockwise: 0, 90, 180 or 270
+} FrameGeometry;
+
+/**
+ * @brief
+ * Compute the output geometry of frame from its sample_aspect_ratio and its
+ * AV_FRAME_DATA_DISPLAYMATRIX side data. Anamorphic frames keep their height
+ * and are stretched or squeezed horizontally.
+ * @param frame
+ * @param geometry
+ */
+void frame_geometry(const AVFrame *frame, FrameGeometry *geometry);
+
+/**
+ * @brief
+ * Convert src into dst (allocated at geometry->width x height) in a single
+ * pass: strips of rows go through the specialized kernel into a small
+ * cache-resident buffer, from which they are resampled to square pixels and
+ * stored rotated.
+ * @param src
+ * @param dst destination frame, dst->format selects the output layout
+ * @param geometry from frame_geometry(src)
+ * @return int 0 on success, -1 when no kernel exists for the pair or out of memory
+ */
+int convert_frame_geometry(const AVFrame *src, AVFrame *dst, const FrameGeometry *geometry);
+
+#endif
@@ -0,0 +1,116 @@
+/**
+ * @file downscale.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Compile-time specialized box filters, see downscale.h.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "downscale.h"
+
+int downscale_factor_parse(const char *text, int *factor) {
+    char *end;
+    long value = strtol(text, &end, 10);
+    if (end == text || *end || (value != 1 && value != 2 && value != 4 && value != 8))
+        return -1;
+    *factor = (int)value;
+    return 0;
+}
+
+/**
+ * @brief
+ * Generate the box filter for 1 << LOG2.
+ *
+ * The rows are first summed column by column into 16-bit lanes, a plain
+ * widening add; the horizontal pass then adds STEP neighbours with a
+ * constant trip count and divides by a shift. Both loops stay in 16 bits so
+ * the compiler vectorizes them with SSE2 or NEON, no intrinsics needed. Only
+ * the edge blocks, short of rows or columns, pay for a division.
+ */
+#define DEFINE_BOX_ROW(NAME, LOG2)                                                              \
+static void NAME(const uint8_t *restrict src, int linesize, int width, int rows,               \
+                 uint16_t *restrict sums, uint8_t *restrict dst)                              \
+{                                                                                               \
+    enum { STEP = 1 << (LOG2), SHIFT = 2 * (LOG2) };                                            \
+    const int full = width >> (LOG2);                                                           \
+                                                                                                \
+    for (int x = 0; x < width; x++)                                                             \
+        sums[x] = src[x];                                                                       \
+    for (int r = 1; r < rows; r++) {                                                            \
+        const uint8_t *restrict row = src + (ptrdiff_t)r * linesize;                            \
+        for (int x = 0; x < width; x++)                                                         \
+            sums[x] += row[x];                                                                  \
+    }                                                                                           \
+                                                                                                \
+    if (rows == STEP) {                                                                         \
+        for (int x = 0; x < full; x++) {                                                        \
+            const uint16_t *block = sums + x * STEP;                                            \
+            uint16_t sum = 0; /* 64 * 255 at most: stays in 16-bit lanes */                     \
+            for (int k = 0; k < STEP; k++)                                                      \
+                sum += block[k];                                                                \
+            dst[x] = (uint8_t)((uint16_t)(sum + (1u << (SHIFT - 1))) >> SHIFT);                 \
+        }                                                                                       \
+    } else {                                                                                    \
+        const unsigned count = rows * STEP;                                                     \
+        for (int x = 0; x < full; x++) {                                                        \
+            unsigned sum = 0;                                                                   \
+            for (int k = 0; k < STEP; k++)                                                      \
+                sum += sums[x * STEP + k];                                                      \
+            dst[x] = (uint8_t)((sum + count / 2) / count);                                      \
+        }                                                                                       \
+    }                                                                                           \
+                                                                                                \
+    if (width & (STEP - 1)) {                                                                   \
+        const unsigned count = rows * (width & (STEP - 1));                                     \
+        unsigned sum = 0;                                                                       \
+        for (int x = full * STEP; x < width; x++)                                               \
+            sum += sums[x];                                                                     \
+        dst[full] = (uint8_t)((sum + count / 2) / count);                                       \
+    }                                                                                           \
+}
+
+DEFINE_BOX_ROW(box_row_2, 1)
+DEFINE_BOX_ROW(box_row_4, 2)
+DEFINE_BOX_ROW(box_row_8, 3)
+
+void downscale_half_rgb_row(const uint8_t *restrict src, int linesize, int width, int rows, uint8_t *restrict dst) {
+    const uint8_t *restrict next = rows > 1 ? src + linesize : src; // a single row counts twice
+    const int full = width >> 1;
+
+    for (int x = 0; x < full; x++) {
+        const uint8_t *a = src + 6 * x, *b = next + 6 * x;
+        for (int c = 0; c < 3; c++)
+            dst[3 * x + c] = (uint8_t)((uint16_t)(a[c] + a[c + 3] + b[c] + b[c + 3] + 2) >> 2);
+    }
+    if (width & 1) {
+        const uint8_t *a = src + 6 * full, *b = next + 6 * full;
+        for (int c = 0; c < 3; c++)
+            dst[3 * full + c] = (uint8_t)((a[c] + b[c] + 1) >> 1);
+    }
+}
+
+void downscale_box_row(const uint8_t *src, int linesize, int width, int rows, int factor, uint16_t *sums, uint8_t *dst) {
+    switch (factor) {
+    case 2:
+        box_row_2(src, linesize, width, rows, sums, dst);
+        break;
+    case 4:
+        box_row_4(src, linesize, width, rows, sums, dst);
+        break;
+    case 8:
+        box_row_8(src, linesize, width, rows, sums, dst);
+        break;
+    default:
+        memcpy(dst, src, width);
+        break;
+    }
+}
@@ -0,0 +1,72 @@
+/**
+ * @file downscale.h
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Box-filter reduction of an 8-bit plane by 2, 4 or 8, one output row at a
+ * time, for small grayscale thumbnails straight from the decoded luma, and a
+ * 2x reduction of packed RGB24 for the levels of a tile pyramid. Every
+ * output sample is the rounded mean of a factor x factor block of the source;
+ * a partial block on the right or bottom edge is averaged over the samples it
+ * has. The source is read in place and nothing goes through swscale, so a
+ * writer can stream each output row to its file as soon as it is computed.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef A3_DOWNSCALE_H
+#define A3_DOWNSCALE_H
+
+#include <stdint.h>
+
+#define DOWNSCALE_MAX_FACTOR 8
+
+/**
+ * @brief
+ * Parse a reduction factor: "1" (none), "2", "4" or "8"
+ * @param text
+ * @param factor
+ * @return int 0 on success, -1 otherwise
+ */
+int downscale_factor_parse(const char *text, int *factor);
+
+/**
+ * @brief
+ * Size of a dimension once reduced, partial blocks included
+ * @param size
+ * @param factor
+ * @return int
+ */
+static inline int downscale_size(int size, int factor) {
+    return (size + factor - 1) / factor;
+}
+
+/**
+ * @brief
+ * Compute one output row from the block of source rows starting at src
+ * @param src first source row of the block
+ * @param linesize
+ * @param width source width
+ * @param rows factor, or fewer on the last block row
+ * @param factor 2, 4 or 8
+ * @param sums scratch of width entries
+ * @param dst downscale_size(width, factor) samples
+ */
+void downscale_box_row(const uint8_t *src, int linesize, int width, int rows, int factor, uint16_t *sums, uint8_t *dst);
+
+/**
+ * @brief
+ * Halve packed RGB24: one output row from two source rows (one on an odd
+ * last row), same rounding and edge rule as downscale_box_row()
+ * @param src first source row
+ * @param linesize
+ * @param width source width in pixels
+ * @param rows 2, or 1 on the last row of an odd height
+ * @param dst downscale_size(width, 2) pixels
+ */
+void downscale_half_rgb_row(const uint8_t *src, int linesize, int width, int rows, uint8_t *dst);
+
+#endif
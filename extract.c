@@ -0,0 +1,270 @@
+/**
+ * @file extract.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief 
+ * 
+ * Extraction core, see extract.h.
+ * 
+ * @version 0.1
+ * @date 2022-10-06
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#include <libavutil/timestamp.h>
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include "extract.h"
+#include "governor.h"
+
+int extract_open_input(ExtractContext *ctx, const char *input) {
+
+    logging("initializing all the containers, codecs and protocols.");
+
+    // AVFormatContext holds the header information from the format (Container) - Allocating memory for this component
+    AVFormatContext *pFormatContext = ctx->pFormatContext = avformat_alloc_context();
+    if (!pFormatContext) {
+        logging("ERROR could not allocate memory for Format Context");
+        extract_close(ctx);
+        return AVERROR(ENOMEM);
+    }
+
+    // reads go through the governor when a read limit may apply
+    if (governor_open_input(&ctx->pIOContext, input) < 0)
+        logging("could not open %s for limited reads, reading it unlimited", input);
+    pFormatContext->pb = ctx->pIOContext;
+
+    // Open the file and read its header. The codecs are not opened.
+    logging("opening the input file (%s) and loading format (container) header", input);
+    int ret = avformat_open_input(&ctx->pFormatContext, input, NULL, NULL);
+    if (ret != 0) {
+        logging("ERROR av could not open the file: %s", av_err2str(ret));
+        governor_close_input(&ctx->pIOContext);
+        return ret; // avformat_open_input() already freed the context
+    }
+
+    // Log some info about file after reading header
+    logging("format %s, duration %lld us, bit_rate %lld", pFormatContext->iformat->name, pFormatContext->duration, pFormatContext->bit_rate);
+    
+    // read Packets from the Format to get stream information, this function populates pFormatContext->streams
+    logging("finding stream info from format");
+    if ((ret = avformat_find_stream_info(pFormatContext,  NULL)) < 0) {
+        logging("ERROR could not get the stream info: %s", av_err2str(ret));
+        extract_close(ctx);
+        return ret;
+    }
+
+    int video_stream_index = -1;
+
+    // loop though all the streams and print its main information
+    for (int i = 0; i < pFormatContext->nb_streams; i++)
+    {
+        AVCodecParameters *pLocalCodecParameters =  NULL;
+        pLocalCodecParameters = pFormatContext->streams[i]->codecpar;
+        logging("AVStream->time_base before open coded %d/%d", pFormatContext->streams[i]->time_base.num, pFormatContext->streams[i]->time_base.den);
+        logging("AVStream->r_frame_rate before open coded %d/%d", pFormatContext->streams[i]->r_frame_rate.num, pFormatContext->streams[i]->r_frame_rate.den);
+        logging("AVStream->start_time %" PRId64, pFormatContext->streams[i]->start_time);
+        logging("AVStream->duration %" PRId64, pFormatContext->streams[i]->duration);
+
+        logging("finding the proper decoder (CODEC)");
+
+        AVCodec *pLocalCodec = NULL;
+        pLocalCodec = avcodec_find_decoder(pLocalCodecParameters->codec_id);   // finds the registered decoder for a codec ID
+
+        if (pLocalCodec==NULL) {
+            logging("ERROR unsupported codec!"); // if the codec is not found, just skip it
+            continue;
+        }
+
+        // when the stream is a video we store its index, codec parameters and codec
+        if (pLocalCodecParameters->codec_type == AVMEDIA_TYPE_VIDEO) {
+        if (video_stream_index == -1) {
+            video_stream_index = i;
+        }
+
+        logging("Video Codec: resolution %d x %d", pLocalCodecParameters->width, pLocalCodecParameters->height);
+        } else if (pLocalCodecParameters->codec_type == AVMEDIA_TYPE_AUDIO) {
+        logging("Audio Codec: %d channels, sample rate %d", pLocalCodecParameters->channels, pLocalCodecParameters->sample_rate);
+        }
+
+        // print its name, id and bitrate
+        logging("\tCodec %s ID %d bit_rate %lld", pLocalCodec->name, pLocalCodec->id, pLocalCodecParameters->bit_rate);
+    } 
+
+    // check file to check if contains video stream 
+    if (video_stream_index == -1) {
+        logging("File %s does not contain a video stream!", input);
+        extract_close(ctx);
+        return AVERROR_STREAM_NOT_FOUND;
+    }
+
+    ctx->video_stream_index = video_stream_index;
+    ctx->pPacket = av_packet_alloc();
+    if (!ctx->pPacket) {
+        logging("failed to allocate memory for AVPacket");
+        extract_close(ctx);
+        return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+static const char *const decode_preset_names[] = {
+    [DECODE_PRESET_EXACT]   = "exact",
+    [DECODE_PRESET_FAST]    = "fast",
+    [DECODE_PRESET_FASTEST] = "fastest",
+};
+
+int decode_preset_parse(const char *name, DecodePreset *preset) {
+    for (int i = 0; i < (int)(sizeof(decode_preset_names) / sizeof(decode_preset_names[0])); i++) {
+        if (!strcmp(name, decode_preset_names[i])) {
+            *preset = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *decode_preset_name(DecodePreset preset) {
+    return decode_preset_names[preset];
+}
+
+/**
+ * @brief 
+ * Set the decoder shortcuts of preset, before avcodec_open2()
+ * @param pCodecContext 
+ * @param preset 
+ */
+static void apply_decode_preset(AVCodecContext *pCodecContext, DecodePreset preset) {
+    switch (preset) {
+    case DECODE_PRESET_EXACT:
+        return;
+    case DECODE_PRESET_FAST:
+        pCodecContext->flags2 |= AV_CODEC_FLAG2_FAST;
+        pCodecContext->skip_loop_filter = AVDISCARD_NONREF; // errors stay in frames nothing predicts from
+        break;
+    case DECODE_PRESET_FASTEST:
+        pCodecContext->flags2 |= AV_CODEC_FLAG2_FAST;
+        pCodecContext->skip_loop_filter = AVDISCARD_ALL;
+        pCodecContext->skip_idct = AVDISCARD_BIDIR;
+        break;
+    }
+    logging("decode preset %s", decode_preset_name(preset));
+}
+
+int extract_open(ExtractContext *ctx, const char *input) {
+    int ret = extract_open_input(ctx, input);
+    if (ret < 0)
+        return ret;
+    return extract_open_decoder(ctx);
+}
+
+int extract_open_decoder(ExtractContext *ctx) {
+    AVCodecParameters *pCodecParameters = ctx->pFormatContext->streams[ctx->video_stream_index]->codecpar;
+    const AVCodec *pCodec = avcodec_find_decoder(pCodecParameters->codec_id); // the component that knows how to enCOde and DECode the stream
+
+    AVCodecContext *pCodecContext = ctx->pCodecContext = avcodec_alloc_context3(pCodec);
+    if (!pCodecContext) {
+        logging("failed to allocated memory for AVCodecContext");
+        extract_close(ctx);
+        return AVERROR(ENOMEM);
+    }
+
+    // Fill the codec context based on the values from the supplied codec parameters
+    int ret = avcodec_parameters_to_context(pCodecContext, pCodecParameters);
+    if (ret < 0){
+        logging("failed to copy codec params to codec context");
+        extract_close(ctx);
+        return ret;
+    }
+
+    apply_decode_preset(pCodecContext, ctx->preset);
+    if (governor_decode_threads() > 0)
+        pCodecContext->thread_count = governor_decode_threads();
+    if (ctx->export_motion_vectors)
+        pCodecContext->flags2 |= AV_CODEC_FLAG2_EXPORT_MVS; // see motion.h
+
+    // Initialize the AVCodecContext to use the given AVCodec.
+    if ((ret = avcodec_open2(pCodecContext, pCodec, NULL)) < 0){
+        logging("failed to open codec through avcodec_open2: %s", av_err2str(ret));
+        extract_close(ctx);
+        return ret;
+    }
+    return 0;
+}
+
+int extract_next_frame(ExtractContext *ctx, AVFrame *pFrame) {
+    for (;;) {
+        int response = avcodec_receive_frame(ctx->pCodecContext, pFrame);
+        if (response >= 0)
+            extract_frame_properties(ctx, pFrame);
+        if (response != AVERROR(EAGAIN))
+            return response; // a frame, AVERROR_EOF once drained, or a decoding error
+
+        if (ctx->draining)
+            return AVERROR_EOF;
+
+        // the decoder wants more input: feed it the next packet of the video stream
+        do {
+            av_packet_unref(ctx->pPacket);
+            response = av_read_frame(ctx->pFormatContext, ctx->pPacket);
+        } while (response >= 0 && ctx->pPacket->stream_index != ctx->video_stream_index);
+
+        if (response < 0) {
+            ctx->draining = 1;
+            response = avcodec_send_packet(ctx->pCodecContext, NULL); // enter draining mode
+        } else {
+            response = avcodec_send_packet(ctx->pCodecContext, ctx->pPacket);
+            av_packet_unref(ctx->pPacket);
+        }
+        if (response < 0 && response != AVERROR_EOF) {
+            logging("Error while sending a packet to the decoder: %s", av_err2str(response));
+            return response;
+        }
+    }
+}
+
+void extract_frame_properties(const ExtractContext *ctx, AVFrame *pFrame) {
+    AVStream *stream = ctx->pFormatContext->streams[ctx->video_stream_index];
+
+    // the container's aspect ratio wins over the codec's, as in ffmpeg/ffplay
+    pFrame->sample_aspect_ratio = av_guess_sample_aspect_ratio(ctx->pFormatContext, stream, pFrame);
+
+    // MP4/MOV keep the rotation of phone videos in the stream, not in the frames
+    if (!av_frame_get_side_data(pFrame, AV_FRAME_DATA_DISPLAYMATRIX)) {
+        size_t size = 0;
+        uint8_t *matrix = av_stream_get_side_data(stream, AV_PKT_DATA_DISPLAYMATRIX, &size);
+        if (matrix && size >= 9 * sizeof(int32_t)) {
+            AVFrameSideData *sd = av_frame_new_side_data(pFrame, AV_FRAME_DATA_DISPLAYMATRIX, size);
+            if (sd)
+                memcpy(sd->data, matrix, size);
+        }
+    }
+}
+
+void extract_close(ExtractContext *ctx) {
+    avformat_close_input(&ctx->pFormatContext); // close stream input
+    governor_close_input(&ctx->pIOContext); // custom I/O is left open by avformat_close_input()
+    av_packet_free(&ctx->pPacket); // free packet resources
+    avcodec_free_context(&ctx->pCodecContext); // free context
+    ctx->video_stream_index = -1;
+    ctx->draining = 0;
+}
+
+/**
+ * @brief 
+ * Function Definition of Logging out Messages
+ * @param fmt 
+ * @param ... 
+ */
+void logging(const char *fmt, ...){
+    char line[1024];
+    va_list args;
+    va_start( args, fmt );
+    vsnprintf( line, sizeof(line), fmt, args );
+    va_end( args );
+    fprintf( stderr, "{LOG}:-- %s\n", line ); // one write per line, so the pipeline threads don't interleave
+}
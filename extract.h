@@ -0,0 +1,119 @@
+/**
+ * @file extract.h
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief 
+ * 
+ * Extraction core: open a media file, pick its video stream and decoder, and
+ * pull decoded frames from it. Used by the A3 command line pipeline and by the
+ * asynchronous API in async.h.
+ * 
+ * @version 0.1
+ * @date 2022-10-06
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef A3_EXTRACT_H
+#define A3_EXTRACT_H
+
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+
+/**
+ * @brief 
+ * Decode quality presets, trading reconstruction accuracy for speed
+ */
+typedef enum DecodePreset {
+    DECODE_PRESET_EXACT,   // bit-exact decode (default)
+    DECODE_PRESET_FAST,    // non-spec-compliant shortcuts, no loop filter on non-reference frames
+    DECODE_PRESET_FASTEST, // no loop filter at all, IDCT skipped on B-frames where supported
+} DecodePreset;
+
+/**
+ * @brief 
+ * An opened input with the decoder of its first video stream
+ */
+typedef struct ExtractContext {
+    AVFormatContext *pFormatContext;
+    AVCodecContext *pCodecContext;
+    int video_stream_index;
+    AVPacket *pPacket; // scratch packet for extract_next_frame()
+    int draining;      // demuxer hit the end, the decoder is being flushed
+    DecodePreset preset; // set before extract_open()
+    int export_motion_vectors; // set before extract_open(): attach AV_FRAME_DATA_MOTION_VECTORS to frames
+    AVIOContext *pIOContext;   // read-limited input (governor.h), NULL when libavformat opened the file itself
+} ExtractContext;
+
+/**
+ * @brief 
+ * Function to log messages
+ * @param fmt 
+ * @param ... 
+ */
+void logging(const char *fmt, ...);
+
+/**
+ * @brief 
+ * Open the input, log its streams and select the first video stream that has
+ * a decoder, without opening the decoder (pCodecContext stays NULL)
+ * @param ctx zero-initialized context, released again on failure
+ * @param input 
+ * @return int 0 on success, a negative AVERROR on failure
+ */
+int extract_open_input(ExtractContext *ctx, const char *input);
+
+/**
+ * @brief 
+ * Open the decoder of the video stream selected by extract_open_input()
+ * @param ctx 
+ * @return int 0 on success, a negative AVERROR on failure (ctx is released)
+ */
+int extract_open_decoder(ExtractContext *ctx);
+
+/**
+ * @brief 
+ * extract_open_input(), then open the decoder of the selected video stream
+ * @param ctx zero-initialized context, released again on failure
+ * @param input 
+ * @return int 0 on success, a negative AVERROR on failure
+ */
+int extract_open(ExtractContext *ctx, const char *input);
+
+/**
+ * @brief 
+ * Parse a preset name
+ * @param name "exact", "fast" or "fastest"
+ * @param preset receives the preset
+ * @return int 0 on success, -1 if the name is unknown
+ */
+int decode_preset_parse(const char *name, DecodePreset *preset);
+
+const char *decode_preset_name(DecodePreset preset);
+
+/**
+ * @brief 
+ * Read and decode until the next video frame is available
+ * @param ctx 
+ * @param pFrame receives the frame, unreferenced first
+ * @return int 0 on success, AVERROR_EOF at the end of the stream, <0 on error
+ */
+int extract_next_frame(ExtractContext *ctx, AVFrame *pFrame);
+
+/**
+ * @brief 
+ * Complete a decoded frame with what only the container knows: its sample
+ * aspect ratio and the display matrix (rotation) of the stream. Done by
+ * extract_next_frame(), callers decoding on their own call it themselves.
+ * @param ctx 
+ * @param pFrame 
+ */
+void extract_frame_properties(const ExtractContext *ctx, AVFrame *pFrame);
+
+/**
+ * @brief 
+ * Release everything extract_open() allocated, safe on a partly opened context
+ * @param ctx 
+ */
+void extract_close(ExtractContext *ctx);
+
+#endif
@@ -0,0 +1,213 @@
+/**
+ * @file extract_coro.hpp
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * C++20 coroutine interface over the asynchronous extraction API (async.h).
+ * Header only; link against libA3.a (make lib) and the FFmpeg libraries.
+ *
+ *   a3::Task extract(a3::Loop &loop, std::string input, std::string prefix) {
+ *       a3::Session session = co_await a3::Session::open(loop, input.c_str());
+ *       if (!session)
+ *           co_return;
+ *       a3::Sink sink(loop, prefix.c_str());
+ *       while (a3::FrameResult result = co_await session.next_frame())
+ *           co_await sink.write(result.frame.get());
+ *   }
+ *
+ * A suspended coroutine costs no thread: it is resumed on a loop thread when
+ * its operation completes, so any number of extractions run on the threads
+ * of one a3::Loop.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef A3_EXTRACT_CORO_HPP
+#define A3_EXTRACT_CORO_HPP
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <utility>
+
+extern "C" {
+#include "async.h"
+}
+
+namespace a3 {
+
+/**
+ * @brief
+ * Fire-and-forget coroutine: starts immediately, frees itself when done.
+ */
+struct Task {
+    struct promise_type {
+        Task get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+/**
+ * @brief
+ * Owner of an AsyncLoop. Destroying it waits for every queued operation.
+ */
+class Loop {
+public:
+    explicit Loop(int cpu_threads = 0, int io_threads = 0)
+        : loop_(async_loop_create(cpu_threads, io_threads)) {
+        if (!loop_)
+            throw std::bad_alloc();
+    }
+    ~Loop() { async_loop_destroy(loop_); }
+    Loop(const Loop &) = delete;
+    Loop &operator=(const Loop &) = delete;
+
+    AsyncLoop *get() const noexcept { return loop_; }
+
+private:
+    AsyncLoop *loop_;
+};
+
+struct FrameDeleter {
+    void operator()(AVFrame *frame) const noexcept { av_frame_free(&frame); }
+};
+using FramePtr = std::unique_ptr<AVFrame, FrameDeleter>;
+
+/**
+ * @brief
+ * Result of Session::next_frame(): a frame, or the end/error status.
+ */
+struct FrameResult {
+    FramePtr frame;
+    int status = 0; // 0, AVERROR_EOF or a negative AVERROR
+
+    explicit operator bool() const noexcept { return frame != nullptr; }
+};
+
+class Session {
+public:
+    Session() = default;
+    explicit Session(AsyncSession *session) noexcept : session_(session) {}
+    Session(Session &&other) noexcept : session_(std::exchange(other.session_, nullptr)) {}
+    Session &operator=(Session &&other) noexcept {
+        std::swap(session_, other.session_);
+        return *this;
+    }
+    ~Session() { async_session_close(session_); }
+
+    explicit operator bool() const noexcept { return session_ != nullptr; }
+
+    struct OpenAwaiter {
+        AsyncLoop *loop;
+        const char *input;
+        AsyncSession *session = nullptr;
+        int status = 0;
+        std::coroutine_handle<> handle;
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> h) noexcept {
+            handle = h;
+            int ret = async_session_open(loop, input, &OpenAwaiter::done, this);
+            if (ret < 0) {
+                status = ret;
+                return false; // nothing queued, resume right away
+            }
+            return true;
+        }
+        Session await_resume() noexcept { return Session(session); }
+
+        static void done(void *opaque, AsyncSession *session, int status) {
+            auto *self = static_cast<OpenAwaiter *>(opaque);
+            self->session = session;
+            self->status = status;
+            self->handle.resume();
+        }
+    };
+
+    struct FrameAwaiter {
+        AsyncSession *session;
+        AVFrame *frame = nullptr;
+        int status = 0;
+        std::coroutine_handle<> handle;
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> h) noexcept {
+            handle = h;
+            int ret = async_session_next_frame(session, &FrameAwaiter::done, this);
+            if (ret < 0) {
+                status = ret;
+                return false;
+            }
+            return true;
+        }
+        FrameResult await_resume() noexcept { return { FramePtr(frame), status }; }
+
+        static void done(void *opaque, AVFrame *frame, int status) {
+            auto *self = static_cast<FrameAwaiter *>(opaque);
+            self->frame = frame;
+            self->status = status;
+            self->handle.resume();
+        }
+    };
+
+    /** co_await Session::open(loop, input) -> Session, empty on failure */
+    static OpenAwaiter open(Loop &loop, const char *input) noexcept { return { loop.get(), input, nullptr, 0, {} }; }
+
+    /** co_await session.next_frame() -> FrameResult, empty at the end of the stream */
+    FrameAwaiter next_frame() noexcept { return { session_, nullptr, 0, {} }; }
+
+private:
+    AsyncSession *session_ = nullptr;
+};
+
+class Sink {
+public:
+    Sink(Loop &loop, const char *prefix) : sink_(async_sink_create(loop.get(), prefix)) {
+        if (!sink_)
+            throw std::bad_alloc();
+    }
+    ~Sink() { async_sink_destroy(sink_); }
+    Sink(const Sink &) = delete;
+    Sink &operator=(const Sink &) = delete;
+
+    struct WriteAwaiter {
+        AsyncSink *sink;
+        const AVFrame *frame;
+        int status = 0;
+        std::coroutine_handle<> handle;
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> h) noexcept {
+            handle = h;
+            int ret = async_sink_write(sink, frame, &WriteAwaiter::done, this);
+            if (ret < 0) {
+                status = ret;
+                return false;
+            }
+            return true;
+        }
+        int await_resume() const noexcept { return status; }
+
+        static void done(void *opaque, int status) {
+            auto *self = static_cast<WriteAwaiter *>(opaque);
+            self->status = status;
+            self->handle.resume();
+        }
+    };
+
+    /** co_await sink.write(frame) -> 0 or a negative AVERROR; frame may be freed right after */
+    WriteAwaiter write(const AVFrame *frame) noexcept { return { sink_, frame, 0, {} }; }
+
+private:
+    AsyncSink *sink_;
+};
+
+} // namespace a3
+
+#endif
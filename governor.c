@@ -0,0 +1,320 @@
+/**
+ * @file governor.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Resource governor, see governor.h.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include <libavutil/mem.h>
+
+#include "extract.h"
+#include "governor.h"
+
+#define READ_BUFFER_SIZE 32768
+#define BYTES_BURST_NS 100000000LL // bandwidth may run up to 100 ms ahead of its budget
+#define NICE_UNSET INT_MIN
+
+// linux/ioprio.h
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_WHO_PROCESS 1
+
+// modification time of a struct stat, with nanoseconds
+#ifdef __APPLE__
+#define STAT_MTIME(st) ((st).st_mtimespec)
+#else
+#define STAT_MTIME(st) ((st).st_mtim)
+#endif
+
+/**
+ * @brief
+ * Generic cell rate algorithm: tat is the time at which everything taken so
+ * far is paid for. A caller may go ahead while tat is less than burst_ns in
+ * the future.
+ */
+typedef struct RateLimiter {
+    atomic_llong rate; // units per second, 0 for no limit
+    atomic_llong tat;  // theoretical arrival time, CLOCK_MONOTONIC ns
+    long long burst_ns;
+} RateLimiter;
+
+typedef struct Governor {
+    atomic_int decode_threads;
+    RateLimiter read, write, frames;
+    atomic_int nice;
+    atomic_int io_class, io_level; // class 0: leave the I/O priority alone
+    atomic_int priority_generation; // bumped whenever nice or ioclass change
+} Governor;
+
+static Governor local_governor = {
+    .read = { .burst_ns = BYTES_BURST_NS },
+    .write = { .burst_ns = BYTES_BURST_NS },
+    .nice = NICE_UNSET,
+};
+static Governor *governor = &local_governor;
+
+static const char *watched_path;
+static struct timespec watched_mtime;
+static int applied_generation;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void rate_limiter_take(RateLimiter *limiter, int64_t units) {
+    long long rate = atomic_load_explicit(&limiter->rate, memory_order_relaxed);
+    if (rate <= 0 || units <= 0)
+        return;
+
+    long long cost = (long long)((double)units * 1e9 / rate);
+    long long now = now_ns();
+    long long tat = atomic_load_explicit(&limiter->tat, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak(&limiter->tat, &tat, (tat > now ? tat : now) + cost))
+        ;
+
+    long long wait = tat - limiter->burst_ns - now;
+    if (wait > 0) {
+        struct timespec ts = { wait / 1000000000LL, wait % 1000000000LL };
+        while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+            ;
+    }
+}
+
+static int parse_rate(const char *value, long long *rate) {
+    char *end;
+    double v = strtod(value, &end);
+    switch (*end) {
+    case 'G': case 'g': v *= 1024;  // fall through
+    case 'M': case 'm': v *= 1024;  // fall through
+    case 'K': case 'k': v *= 1024; end++;
+    }
+    if (end == value || *end || v < 0)
+        return -1;
+    *rate = (long long)v;
+    return 0;
+}
+
+static int parse_io_class(const char *value, int *io_class, int *level) {
+    *level = 4;
+    if (!strcmp(value, "idle")) {
+        *io_class = 3;
+        *level = 0;
+        return 0;
+    }
+    if (!strncmp(value, "be", 2))
+        *io_class = 2;
+    else if (!strncmp(value, "rt", 2))
+        *io_class = 1;
+    else
+        return -1;
+    value += 2;
+    if (*value == ':') {
+        char *end;
+        *level = (int)strtol(value + 1, &end, 10);
+        value = end;
+    }
+    return *value || *level < 0 || *level > 7 ? -1 : 0;
+}
+
+int governor_set(const char *name, const char *value) {
+    long long rate;
+    char *end;
+
+    if (!strcmp(name, "threads")) {
+        long threads = strtol(value, &end, 10);
+        if (end == value || *end || threads < 0 || threads > 1024)
+            return -1;
+        atomic_store(&governor->decode_threads, (int)threads);
+    } else if (!strcmp(name, "read-limit") || !strcmp(name, "write-limit")) {
+        if (parse_rate(value, &rate) < 0)
+            return -1;
+        atomic_store(name[0] == 'r' ? &governor->read.rate : &governor->write.rate, rate);
+    } else if (!strcmp(name, "max-fps")) {
+        double fps = strtod(value, &end);
+        if (end == value || *end || fps < 0)
+            return -1;
+        // the frame limiter counts in thousandths of a frame to keep fractional rates
+        atomic_store(&governor->frames.rate, (long long)(fps * 1000));
+    } else if (!strcmp(name, "nice")) {
+        long nice = strtol(value, &end, 10);
+        if (end == value || *end || nice < -20 || nice > 19)
+            return -1;
+        if (atomic_exchange(&governor->nice, (int)nice) != nice)
+            atomic_fetch_add(&governor->priority_generation, 1);
+    } else if (!strcmp(name, "ioclass")) {
+        int io_class, level;
+        if (parse_io_class(value, &io_class, &level) < 0)
+            return -1;
+        int changed = atomic_exchange(&governor->io_class, io_class) != io_class;
+        changed |= atomic_exchange(&governor->io_level, level) != level;
+        if (changed)
+            atomic_fetch_add(&governor->priority_generation, 1);
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int governor_load(const char *path) {
+    char line[256], name[64], value[128];
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        logging("could not open the governor file %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    int ret = 0, number = 0;
+    while (fgets(line, sizeof(line), f)) {
+        number++;
+        line[strcspn(line, "#\n")] = 0;
+        int fields = sscanf(line, "%63s %127s", name, value);
+        if (fields <= 0)
+            continue;
+        if (fields != 2 || governor_set(name, value) < 0) {
+            logging("%s:%d: invalid governor setting '%s'", path, number, line);
+            ret = -1;
+        }
+    }
+    fclose(f);
+    return ret;
+}
+
+int governor_share(void) {
+    if (governor != &local_governor)
+        return 0;
+    Governor *shared = mmap(NULL, sizeof(*shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        logging("could not share the governor state: %s", strerror(errno));
+        return -1;
+    }
+    memcpy(shared, &local_governor, sizeof(*shared)); // nothing else runs yet: a plain copy of the atomics is safe
+    governor = shared;
+    return 0;
+}
+
+int governor_watch(const char *path) {
+    struct stat st;
+    watched_path = path;
+    if (stat(path, &st) < 0)
+        return 0; // may be created later
+    watched_mtime = STAT_MTIME(st);
+    return governor_load(path);
+}
+
+void governor_poll(void) {
+    struct stat st;
+    if (!watched_path || stat(watched_path, &st) < 0)
+        return;
+    struct timespec mtime = STAT_MTIME(st);
+    if (mtime.tv_sec == watched_mtime.tv_sec && mtime.tv_nsec == watched_mtime.tv_nsec)
+        return;
+    watched_mtime = mtime;
+    if (governor_load(watched_path) == 0)
+        logging("governor limits reloaded from %s", watched_path);
+    governor_apply_priority();
+}
+
+void governor_apply_priority(void) {
+    int generation = atomic_load(&governor->priority_generation);
+    if (generation == applied_generation)
+        return;
+    applied_generation = generation;
+
+    int nice = atomic_load(&governor->nice);
+    if (nice != NICE_UNSET && setpriority(PRIO_PROCESS, 0, nice) < 0)
+        logging("could not set nice %d: %s", nice, strerror(errno));
+
+    int io_class = atomic_load(&governor->io_class), level = atomic_load(&governor->io_level);
+#ifdef __linux__
+    if (io_class && syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, io_class << IOPRIO_CLASS_SHIFT | level) < 0)
+        logging("could not set the I/O class: %s", strerror(errno));
+#else
+    (void)level;
+    if (io_class)
+        logging("--ioclass is only supported on Linux, ignored");
+#endif
+}
+
+int governor_decode_threads(void) {
+    return atomic_load_explicit(&governor->decode_threads, memory_order_relaxed);
+}
+
+void governor_read(int64_t bytes) {
+    rate_limiter_take(&governor->read, bytes);
+}
+
+void governor_write(int64_t bytes) {
+    rate_limiter_take(&governor->write, bytes);
+}
+
+void governor_frame(void) {
+    rate_limiter_take(&governor->frames, 1000);
+}
+
+static int governed_read(void *opaque, uint8_t *buf, int size) {
+    int n = avio_read_partial(opaque, buf, size);
+    if (n == 0)
+        return AVERROR_EOF;
+    if (n > 0)
+        governor_read(n);
+    return n;
+}
+
+static int64_t governed_seek(void *opaque, int64_t offset, int whence) {
+    if (whence & AVSEEK_SIZE)
+        return avio_size(opaque);
+    return avio_seek(opaque, offset, whence & ~AVSEEK_FORCE);
+}
+
+int governor_open_input(AVIOContext **pb, const char *url) {
+    AVIOContext *inner = NULL;
+    *pb = NULL;
+    if (atomic_load(&governor->read.rate) <= 0 && !watched_path)
+        return 0;
+
+    int ret = avio_open2(&inner, url, AVIO_FLAG_READ, NULL, NULL);
+    if (ret < 0)
+        return ret;
+    unsigned char *buffer = av_malloc(READ_BUFFER_SIZE);
+    if (buffer)
+        *pb = avio_alloc_context(buffer, READ_BUFFER_SIZE, 0, inner, governed_read, NULL, inner->seekable ? governed_seek : NULL);
+    if (!*pb) {
+        av_free(buffer);
+        avio_closep(&inner);
+        return AVERROR(ENOMEM);
+    }
+    (*pb)->seekable = inner->seekable;
+    return 0;
+}
+
+void governor_close_input(AVIOContext **pb) {
+    if (!*pb)
+        return;
+    AVIOContext *inner = (*pb)->opaque;
+    av_freep(&(*pb)->buffer);
+    avio_context_free(pb);
+    avio_closep(&inner);
+}
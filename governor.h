@@ -0,0 +1,128 @@
+/**
+ * @file governor.h
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Resource governor for running A3 next to other services: decoder thread
+ * count, read and write bandwidth, output frame rate and the CPU/I/O
+ * scheduling class of the process. Every limit is off (0) by default.
+ *
+ * Bandwidth and frame rate go through lock-free rate limiters: one atomic
+ * compare-and-swap per read chunk, written file or frame, and a sleep only
+ * when the caller is ahead of its budget. Reads are limited inside a custom
+ * AVIOContext wrapped around the input, writes in the frame writers.
+ *
+ * Limits are set by name, from the command line or from a control file of
+ * "name value" lines:
+ *
+ *   threads      decoder threads, 0 for FFmpeg's choice
+ *   read-limit   input bytes/s, with an optional K, M or G suffix (x1024)
+ *   write-limit  output bytes/s, same format
+ *   max-fps      decoded frames/s
+ *   nice         CPU nice value, -20..19
+ *   ioclass      idle, be[:0-7] or rt[:0-7] (ioprio_set(2))
+ *
+ * In supervisor mode the state lives in shared memory and the supervisor
+ * re-reads the control file whenever it changes, so the limits of running
+ * workers can be adjusted without restarting the batch.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef A3_GOVERNOR_H
+#define A3_GOVERNOR_H
+
+#include <stdint.h>
+
+#include <libavformat/avio.h>
+
+/**
+ * @brief
+ * Set one limit
+ * @param name see the list above
+ * @param value
+ * @return int 0 on success, -1 if the name or value is invalid
+ */
+int governor_set(const char *name, const char *value);
+
+/**
+ * @brief
+ * Apply a control file of "name value" lines ('#' starts a comment)
+ * @param path
+ * @return int 0 on success, -1 if the file cannot be read or has an invalid line
+ */
+int governor_load(const char *path);
+
+/**
+ * @brief
+ * Move the governor state to memory shared with processes forked afterwards,
+ * so their rate limits are global instead of per process
+ * @return int 0 on success, -1 on failure (the state stays process-local)
+ */
+int governor_share(void);
+
+/**
+ * @brief
+ * Watch a control file: governor_poll() reloads it when its mtime changes
+ * @param path control file, applied right away if it exists
+ * @return int 0 on success, -1 if it exists but is invalid
+ */
+int governor_watch(const char *path);
+
+/**
+ * @brief
+ * Reload the watched control file if it changed since the last call
+ */
+void governor_poll(void);
+
+/**
+ * @brief
+ * Apply the nice value and I/O class to the calling thread and the threads
+ * it creates afterwards, if they changed since the last call in this process
+ */
+void governor_apply_priority(void);
+
+/**
+ * @brief
+ * Decoder thread count, 0 to leave it to FFmpeg
+ */
+int governor_decode_threads(void);
+
+/**
+ * @brief
+ * Account for bytes read or written, sleeping while over the limit
+ * @param bytes
+ */
+void governor_read(int64_t bytes);
+void governor_write(int64_t bytes);
+
+/**
+ * @brief
+ * Account for one output frame, sleeping while over max-fps. Called where a
+ * frame is emitted (written, or handed to the writers), not for every decoded
+ * frame: the frames that -t, -b or --shard decode and discard are not charged
+ */
+void governor_frame(void);
+
+/**
+ * @brief
+ * Open input through an AVIOContext that charges every read to read-limit.
+ * Only done when reads can be limited (a read limit is set or the limits
+ * are watched), since formats that open their own files bypass it.
+ * @param pb receives the context, NULL if reads are not governed
+ * @param url
+ * @return int 0 on success or when not governed, <0 AVERROR on failure
+ */
+int governor_open_input(AVIOContext **pb, const char *url);
+
+/**
+ * @brief
+ * Close a context opened by governor_open_input(), NULL is allowed
+ * @param pb
+ */
+void governor_close_input(AVIOContext **pb);
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ * @file motion.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Motion-vector based activity estimation, see motion.h.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include <libavutil/motion_vector.h>
+
+#include <inttypes.h>
+
+#include "extract.h"
+#include "motion.h"
+
+double motion_energy(const AVFrame *frame) {
+    const AVFrameSideData *sd = av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS);
+    if (!sd || !sd->size)
+        return -1;
+
+    const AVMotionVector *mvs = (const AVMotionVector *)sd->data;
+    size_t count = sd->size / sizeof(*mvs);
+    double energy = 0;
+    for (size_t i = 0; i < count; i++) {
+        const AVMotionVector *mv = &mvs[i];
+        double scale = mv->motion_scale ? mv->motion_scale : 1;
+        double dx = mv->motion_x / scale, dy = mv->motion_y / scale;
+        // bi-predicted blocks export one vector per direction, each weighs in
+        energy += (double)mv->w * mv->h * (dx * dx + dy * dy);
+    }
+
+    double area = (double)frame->width * frame->height;
+    return area > 0 ? energy / area : 0;
+}
+
+int motion_filter_init(MotionFilter *filter, double threshold, const char *prefix) {
+    char filename[1024];
+    snprintf(filename, sizeof(filename), "%s-energy.csv", prefix);
+
+    filter->threshold = threshold;
+    filter->last_energy = 0;
+    filter->log = fopen(filename, "w");
+    if (!filter->log) {
+        logging("could not open %s", filename);
+        return -1;
+    }
+    fprintf(filter->log, "frame,pts,type,energy,carried,selected\n");
+    return 0;
+}
+
+int motion_filter_select(MotionFilter *filter, const AVFrame *frame, int fnumber) {
+    double energy = motion_energy(frame);
+    int intra = energy < 0;
+    if (intra)
+        energy = filter->last_energy; // no vectors: assume the motion goes on
+    filter->last_energy = energy;
+
+    int selected = energy >= filter->threshold;
+    if (filter->log)
+        fprintf(filter->log, "%d,%" PRId64 ",%c,%.3f,%d,%d\n", fnumber, frame->best_effort_timestamp,
+                av_get_picture_type_char(frame->pict_type), energy, intra, selected);
+    return selected;
+}
+
+void motion_filter_close(MotionFilter *filter) {
+    if (filter->log)
+        fclose(filter->log);
+    filter->log = NULL;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file motion.h
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Motion activity from the motion vectors the decoder already computed
+ * (AV_CODEC_FLAG2_EXPORT_MVS), without differencing any pixels. The motion
+ * energy of a frame is the mean squared displacement per pixel, in pixels^2,
+ * over all its motion-compensated blocks.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef A3_MOTION_H
+#define A3_MOTION_H
+
+#include <stdio.h>
+#include <libavutil/frame.h>
+
+/**
+ * @brief
+ * Frame selection by motion energy
+ */
+typedef struct MotionFilter {
+    double threshold;   // frames at or above it are selected
+    double last_energy; // carried over to intra frames, which have no vectors
+    FILE *log;          // per-frame CSV, may be NULL
+} MotionFilter;
+
+/**
+ * @brief
+ * Motion energy of a frame decoded with AV_CODEC_FLAG2_EXPORT_MVS
+ * @param frame
+ * @return double energy >= 0, or -1 if the frame carries no motion vectors (intra)
+ */
+double motion_energy(const AVFrame *frame);
+
+/**
+ * @brief
+ * Start a filter, logging every score to <prefix>-energy.csv
+ * @param filter
+ * @param threshold
+ * @param prefix
+ * @return int 0 on success, -1 if the log could not be created
+ */
+int motion_filter_init(MotionFilter *filter, double threshold, const char *prefix);
+
+/**
+ * @brief
+ * Score a frame and decide whether it is selected. Called from the decode
+ * thread only, in decoding order.
+ * @param filter
+ * @param frame
+ * @param fnumber number the frame is saved under
+ * @return int 1 if selected, 0 otherwise
+ */
+int motion_filter_select(MotionFilter *filter, const AVFrame *frame, int fnumber);
+
+void motion_filter_close(MotionFilter *filter);
+
+#endif
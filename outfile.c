@@ -0,0 +1,257 @@
+/**
+ * @file outfile.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Output files written in place, see outfile.h.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#define _GNU_SOURCE // O_DIRECT, sync_file_range()
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "governor.h"
+#include "outfile.h"
+
+/** alignment of the buffer, offset and length of an O_DIRECT write: a page covers every logical block size */
+#define DIRECT_ALIGN 4096
+/** aligned buffers kept for reuse, about one per writer thread */
+#define DIRECT_POOL_SIZE 16
+
+static WriteMode write_mode = WRITE_MODE_AUTO;
+
+static const char *const write_mode_names[] = { "auto", "buffered", "mmap", "direct", "dontneed" };
+
+typedef struct PooledBuffer {
+    uint8_t *data;
+    size_t capacity;
+} PooledBuffer;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static PooledBuffer pool[DIRECT_POOL_SIZE];
+static int pool_count;
+
+int write_mode_parse(const char *name, WriteMode *mode) {
+    for (int i = 0; i < (int)(sizeof(write_mode_names) / sizeof(write_mode_names[0])); i++) {
+        if (!strcmp(name, write_mode_names[i])) {
+            *mode = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void outfile_set_mode(WriteMode mode) {
+    write_mode = mode;
+}
+
+/**
+ * @brief
+ * An aligned buffer of at least size bytes, rounded up to whole pages: a
+ * pooled one if one is large enough, a new one otherwise
+ */
+static uint8_t *pool_get(size_t size, size_t *capacity) {
+    size = (size + DIRECT_ALIGN - 1) & ~(size_t)(DIRECT_ALIGN - 1);
+    pthread_mutex_lock(&pool_lock);
+    for (int i = 0; i < pool_count; i++) {
+        if (pool[i].capacity >= size) {
+            PooledBuffer buffer = pool[i];
+            pool[i] = pool[--pool_count];
+            pthread_mutex_unlock(&pool_lock);
+            *capacity = buffer.capacity;
+            return buffer.data;
+        }
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    void *data;
+    if (posix_memalign(&data, DIRECT_ALIGN, size) != 0)
+        return NULL;
+    *capacity = size;
+    return data;
+}
+
+/**
+ * @brief
+ * Give a buffer back to the pool; when it is full, the smallest buffer goes
+ */
+static void pool_put(uint8_t *data, size_t capacity) {
+    pthread_mutex_lock(&pool_lock);
+    if (pool_count < DIRECT_POOL_SIZE) {
+        pool[pool_count++] = (PooledBuffer){ data, capacity };
+        data = NULL;
+    } else {
+        int smallest = 0;
+        for (int i = 1; i < pool_count; i++) {
+            if (pool[i].capacity < pool[smallest].capacity)
+                smallest = i;
+        }
+        if (pool[smallest].capacity < capacity) {
+            PooledBuffer evicted = pool[smallest];
+            pool[smallest] = (PooledBuffer){ data, capacity };
+            data = evicted.data;
+        }
+    }
+    pthread_mutex_unlock(&pool_lock);
+    free(data);
+}
+
+/**
+ * @brief
+ * Allocate the blocks of the first size bytes of fd and extend it to size
+ * @return int 0, or nonzero if they could not all be allocated
+ */
+static int reserve_blocks(int fd, size_t size) {
+#ifdef __APPLE__
+    (void)fd;
+    (void)size;
+    return -1; // no posix_fallocate(): the mapped mode falls back to buffered
+#else
+    return size > 0 ? posix_fallocate(fd, 0, (off_t)size) : -1;
+#endif
+}
+
+int outfile_open(OutFile *file, const char *filename, size_t size) {
+    *file = (OutFile){ .filename = filename, .fd = -1, .size = size, .capacity = size, .mode = write_mode };
+    if (file->mode == WRITE_MODE_AUTO)
+        file->mode = size >= OUTFILE_MMAP_MIN_SIZE ? WRITE_MODE_MMAP : WRITE_MODE_BUFFERED;
+
+    int flags = O_RDWR | O_CREAT | O_TRUNC; // a shared mapping needs read access too
+#ifdef O_DIRECT
+    if (file->mode == WRITE_MODE_DIRECT) {
+        file->fd = open(filename, flags | O_DIRECT, 0644);
+        if (file->fd < 0 && errno != EINVAL)
+            return -1;
+    }
+#endif
+    if (file->fd < 0) {
+        if (file->mode == WRITE_MODE_DIRECT)
+            file->mode = WRITE_MODE_DONTNEED; // e.g. tmpfs, or no O_DIRECT on this system
+        file->fd = open(filename, flags, 0644);
+        if (file->fd < 0)
+            return -1;
+    }
+
+    if (file->mode == WRITE_MODE_MMAP) {
+        // the blocks must exist before the stores: on a sparse file a full disk
+        // raises SIGBUS in the writer instead of an error from write(2)
+        if (reserve_blocks(file->fd, size) == 0) {
+            void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file->fd, 0);
+            if (map != MAP_FAILED) {
+                file->data = map;
+                return 0;
+            }
+        }
+        file->mode = WRITE_MODE_BUFFERED; // no space or no mmap support: write(2) reports it
+    }
+
+    if (file->mode == WRITE_MODE_DIRECT)
+        file->data = pool_get(size, &file->capacity);
+    else
+        file->data = malloc(size);
+    if (!file->data) {
+        close(file->fd);
+        errno = ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief
+ * pwrite(2) all of buf at offset, resuming after short writes
+ */
+static int write_all(int fd, const uint8_t *buf, size_t size, off_t offset) {
+    while (size > 0) {
+        ssize_t written = pwrite(fd, buf, size, offset);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        buf += written;
+        size -= written;
+        offset += written;
+    }
+    return 0;
+}
+
+/**
+ * @brief
+ * Write size bytes with O_DIRECT: whole pages, the padding is cut off afterwards
+ */
+static int write_direct(OutFile *file, size_t size) {
+    size_t padded = (size + DIRECT_ALIGN - 1) & ~(size_t)(DIRECT_ALIGN - 1);
+    memset(file->data + size, 0, padded - size);
+    if (write_all(file->fd, file->data, padded, 0) < 0) {
+        if (errno != EINVAL)
+            return -1;
+        // a logical block larger than a page: write this file through the page cache
+#ifdef O_DIRECT
+        fcntl(file->fd, F_SETFL, fcntl(file->fd, F_GETFL) & ~O_DIRECT);
+#endif
+        if (write_all(file->fd, file->data, size, 0) < 0 || outfile_release(file->fd, 0, size) < 0)
+            return -1;
+    }
+    return padded > size ? ftruncate(file->fd, size) : 0;
+}
+
+int outfile_close(OutFile *file, size_t size) {
+    int ret = 0, saved_errno = 0;
+    governor_write(size);
+
+    if (file->mode == WRITE_MODE_MMAP) {
+        if (munmap(file->data, file->size) < 0 || (size < file->size && ftruncate(file->fd, size) < 0)) {
+            ret = -1;
+            saved_errno = errno;
+        }
+    } else if (file->mode == WRITE_MODE_DIRECT) {
+        ret = write_direct(file, size);
+        if (ret < 0)
+            saved_errno = errno;
+        pool_put(file->data, file->capacity);
+    } else {
+        ret = write_all(file->fd, file->data, size, 0);
+        if (ret == 0 && file->mode == WRITE_MODE_DONTNEED)
+            ret = outfile_release(file->fd, 0, size);
+        if (ret < 0)
+            saved_errno = errno;
+        free(file->data);
+    }
+    if (close(file->fd) < 0 && ret == 0) {
+        ret = -1;
+        saved_errno = errno;
+    }
+    file->data = NULL;
+    file->fd = -1;
+    errno = saved_errno;
+    return ret;
+}
+
+int outfile_release(int fd, int64_t offset, size_t size) {
+    if (write_mode != WRITE_MODE_DIRECT && write_mode != WRITE_MODE_DONTNEED)
+        return 0;
+    // the pages must be clean before they can be dropped
+#ifdef SYNC_FILE_RANGE_WRITE
+    if (sync_file_range(fd, offset, size, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER) < 0)
+        return -1;
+#else
+    if (fdatasync(fd) < 0)
+        return -1;
+#endif
+#ifdef POSIX_FADV_DONTNEED
+    posix_fadvise(fd, offset, size, POSIX_FADV_DONTNEED);
+#endif
+    return 0;
+}
@@ -0,0 +1,117 @@
+/**
+ * @file outfile.h
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Output files whose content is produced in place. The writer opens a file
+ * with an upper bound of its size, gets a buffer, writes the image header
+ * and converts the pixels straight into it, then closes the file with the
+ * final size. How the buffer reaches the disk is the write mode:
+ *
+ *   buffered  a heap buffer handed to write(2) when the file is closed
+ *   mmap      the file itself: posix_fallocate(3) to the size, then a
+ *             shared mapping, so the conversion writes into the page cache
+ *             and no staging copy is made; buffered if the blocks cannot be
+ *             allocated (full disk, or macOS)
+ *   auto      mmap for files of OUTFILE_MMAP_MIN_SIZE bytes and more,
+ *             buffered below
+ *   direct    O_DIRECT from a pool of page aligned buffers: the tail is
+ *             padded with zeros to a whole page, written, and cut off again
+ *             with ftruncate(2); the content never enters the page cache
+ *   dontneed  buffered, then sync_file_range(2) and POSIX_FADV_DONTNEED
+ *             drop the written pages from the page cache
+ *
+ * The last two are for backfills: the outputs are written once and not read
+ * back, and caching them evicts the input videos and the hot data of other
+ * services on the host. They cost write-back latency in the writer threads
+ * (make bench-pagecache measures both sides). A file system without
+ * O_DIRECT support gets dontneed instead.
+ *
+ * Mapping a file and faulting its pages in one at a time has a fixed cost
+ * per page that the saved copy has to pay for. On the x86-64 VM / ext4
+ * machine the modes were measured on (make bench-outfile), buffered won at
+ * every size from a 160x90 thumbnail to 4K, by 1.5-2x, so auto never maps
+ * unless the build sets the threshold, e.g. CFLAGS=-DOUTFILE_MMAP_MIN_SIZE=8388608
+ * after the benchmark showed mmap ahead above that size on the target.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef A3_OUTFILE_H
+#define A3_OUTFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef OUTFILE_MMAP_MIN_SIZE
+#define OUTFILE_MMAP_MIN_SIZE SIZE_MAX
+#endif
+
+typedef enum WriteMode {
+    WRITE_MODE_AUTO, // the default
+    WRITE_MODE_BUFFERED,
+    WRITE_MODE_MMAP,
+    WRITE_MODE_DIRECT,
+    WRITE_MODE_DONTNEED,
+} WriteMode;
+
+typedef struct OutFile {
+    const char *filename;
+    int fd;
+    uint8_t *data; // where the content goes, size bytes
+    size_t size;   // upper bound given to outfile_open()
+    size_t capacity; // of data, a whole number of pages in DIRECT mode
+    WriteMode mode; // anything but AUTO, as resolved for this file
+} OutFile;
+
+/**
+ * @brief
+ * Parse "auto", "buffered", "mmap", "direct" or "dontneed"
+ * @param name
+ * @param mode
+ * @return int 0 on success, -1 if unknown
+ */
+int write_mode_parse(const char *name, WriteMode *mode);
+
+/**
+ * @brief
+ * Select the write mode of every file opened from now on
+ * @param mode
+ */
+void outfile_set_mode(WriteMode mode);
+
+/**
+ * @brief
+ * Create filename and get a buffer for its content
+ * @param file
+ * @param filename must outlive the file
+ * @param size upper bound of the content, > 0
+ * @return int 0 on success, -1 with errno set on failure
+ */
+int outfile_open(OutFile *file, const char *filename, size_t size);
+
+/**
+ * @brief
+ * Write the first size bytes of the buffer out and close the file; the buffer is gone
+ * @param file
+ * @param size final size, at most the size given to outfile_open()
+ * @return int 0 on success, -1 with errno set on failure (the file is closed anyway)
+ */
+int outfile_close(OutFile *file, size_t size);
+
+/**
+ * @brief
+ * For outputs written without OutFile (the raw planes of yuv.c): in the
+ * direct and dontneed modes, write back a range just written to fd and drop
+ * it from the page cache; nothing in the other modes
+ * @param fd
+ * @param offset
+ * @param size
+ * @return int 0 on success, -1 with errno set if the write-back failed
+ */
+int outfile_release(int fd, int64_t offset, size_t size);
+
+#endif
@@ -0,0 +1,138 @@
+/**
+ * @file passthrough.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Zero-decode extraction for intra-only image codecs, see passthrough.h.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "extract.h"
+#include "governor.h"
+#include "outfile.h"
+#include "passthrough.h"
+
+#define JPEG_MARKER_DHT 0xC4
+#define JPEG_MARKER_SOI 0xD8
+#define JPEG_MARKER_SOS 0xDA
+
+/**
+ * @brief
+ * DHT segment with the example tables of ITU-T T.81 Annex K.3, the tables
+ * MJPEG streams that leave out their own (AVI1) are coded with
+ */
+static const uint8_t standard_dht[] = {
+    0xFF, JPEG_MARKER_DHT, 0x01, 0xA2,
+    // DC luminance
+    0x00,
+    0x00, 0x01, 0x05, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B,
+    // DC chrominance
+    0x01,
+    0x00, 0x03, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B,
+    // AC luminance
+    0x10,
+    0x00, 0x02, 0x01, 0x03, 0x03, 0x02, 0x04, 0x03, 0x05, 0x05, 0x04, 0x04, 0x00, 0x00, 0x01, 0x7D,
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08, 0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7,
+    0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5,
+    0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2,
+    0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+    0xF9, 0xFA,
+    // AC chrominance
+    0x11,
+    0x00, 0x02, 0x01, 0x02, 0x04, 0x04, 0x03, 0x04, 0x07, 0x05, 0x04, 0x04, 0x00, 0x01, 0x02, 0x77,
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0,
+    0x15, 0x62, 0x72, 0xD1, 0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26,
+    0x27, 0x28, 0x29, 0x2A, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5,
+    0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3,
+    0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA,
+    0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+    0xF9, 0xFA,
+};
+
+const char *passthrough_extension(enum AVCodecID codec_id) {
+    switch (codec_id) {
+    case AV_CODEC_ID_MJPEG:
+        return "jpg";
+    case AV_CODEC_ID_PNG:
+        return "png";
+    case AV_CODEC_ID_JPEG2000:
+        return "j2k"; // raw codestream, as carried in MOV/MXF
+    default:
+        return NULL;
+    }
+}
+
+/**
+ * @brief
+ * Find where the standard Huffman tables have to go in a JPEG image
+ * @param data
+ * @param size
+ * @return int offset of the SOS marker if the image has no DHT segment before it, 0 otherwise
+ */
+static int jpeg_dht_insert_offset(const uint8_t *data, int size) {
+    if (size < 4 || data[0] != 0xFF || data[1] != JPEG_MARKER_SOI)
+        return 0;
+
+    int pos = 2;
+    while (pos + 4 <= size && data[pos] == 0xFF) {
+        uint8_t marker = data[pos + 1];
+        if (marker == 0xFF) { // fill byte
+            pos++;
+            continue;
+        }
+        if (marker == JPEG_MARKER_DHT)
+            return 0;
+        if (marker == JPEG_MARKER_SOS)
+            return pos;
+        pos += 2 + (data[pos + 2] << 8 | data[pos + 3]);
+    }
+    return 0; // not a header we understand, write it untouched
+}
+
+int passthrough_write_packet(const AVPacket *pPacket, enum AVCodecID codec_id, const char *prefix, int fnumber) {
+    char frame_filename[1024];
+    snprintf(frame_filename, sizeof(frame_filename), "%s-%d.%s", prefix, fnumber, passthrough_extension(codec_id));
+
+    governor_frame();
+    int split = codec_id == AV_CODEC_ID_MJPEG ? jpeg_dht_insert_offset(pPacket->data, pPacket->size) : 0;
+    size_t size = pPacket->size + (split ? sizeof(standard_dht) : 0);
+
+    // through outfile.h like the decoded images: --write-mode applies, and close charges write-limit
+    OutFile file;
+    if (outfile_open(&file, frame_filename, size) < 0) {
+        logging("could not open %s: %s", frame_filename, strerror(errno));
+        return AVERROR(errno);
+    }
+    if (split) {
+        memcpy(file.data, pPacket->data, split);
+        memcpy(file.data + split, standard_dht, sizeof(standard_dht));
+        memcpy(file.data + split + sizeof(standard_dht), pPacket->data + split, pPacket->size - split);
+    } else {
+        memcpy(file.data, pPacket->data, pPacket->size);
+    }
+    if (outfile_close(&file, size) < 0) {
+        logging("could not write %s: %s", frame_filename, strerror(errno));
+        return AVERROR(errno);
+    }
+    return 0;
+}
@@ -0,0 +1,42 @@
+/**
+ * @file passthrough.h
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Zero-decode extraction for intra-only image codecs. When every packet of
+ * the video stream is already a standalone image (MJPEG, PNG, JPEG 2000),
+ * the packets are written out as image files without decoding them.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef A3_PASSTHROUGH_H
+#define A3_PASSTHROUGH_H
+
+#include <libavcodec/avcodec.h>
+
+/**
+ * @brief
+ * File extension of the images carried by codec_id packets
+ * @param codec_id
+ * @return const char* "jpg", "png", ... or NULL if the packets are not standalone images
+ */
+const char *passthrough_extension(enum AVCodecID codec_id);
+
+/**
+ * @brief
+ * Write a packet as <prefix>-<fnumber>.<extension>. MJPEG packets without
+ * Huffman tables (AVI1 style) get the standard tables inserted so that the
+ * file is a valid JPEG.
+ * @param pPacket
+ * @param codec_id codec of the stream, passthrough_extension() must not be NULL for it
+ * @param prefix
+ * @param fnumber
+ * @return int 0 on success, <0 on failure
+ */
+int passthrough_write_packet(const AVPacket *pPacket, enum AVCodecID codec_id, const char *prefix, int fnumber);
+
+#endif
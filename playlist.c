@@ -0,0 +1,157 @@
+/**
+ * @file playlist.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Continuous timeline over several inputs, see playlist.h.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include <stdlib.h>
+
+#include <libavutil/common.h>
+#include <libavutil/mathematics.h>
+
+#include "playlist.h"
+
+static void *prefetch_thread(void *arg) {
+    PlaylistSegment *segment = arg;
+    segment->opened = extract_open(&segment->extract, segment->input) == 0;
+    return NULL;
+}
+
+/**
+ * @brief
+ * Open segments[index] on a background thread, or right away if no thread can be started
+ */
+static void start_prefetch(Playlist *playlist, int index) {
+    if (index >= playlist->nb_segments)
+        return;
+    playlist->prefetch_index = index;
+    if (pthread_create(&playlist->prefetch, NULL, prefetch_thread, &playlist->segments[index]) == 0) {
+        playlist->prefetching = 1;
+        return;
+    }
+    prefetch_thread(&playlist->segments[index]);
+    playlist->prefetching = 0;
+}
+
+static const AVStream *segment_stream(const PlaylistSegment *segment) {
+    return segment->extract.pFormatContext->streams[segment->extract.video_stream_index];
+}
+
+int playlist_open(Playlist *playlist, char *const *inputs, int nb_inputs, const ExtractContext *options) {
+    *playlist = (Playlist){ .nb_segments = nb_inputs, .prefetch_index = -1 };
+    playlist->segments = calloc(nb_inputs, sizeof(*playlist->segments));
+    if (!playlist->segments)
+        return -1;
+    for (int i = 0; i < nb_inputs; i++) {
+        playlist->segments[i].input = inputs[i];
+        playlist->segments[i].extract = *options;
+        playlist->segments[i].extract.video_stream_index = -1;
+    }
+
+    // the timeline starts with the first segment that opens
+    int index = 0;
+    for (; index < nb_inputs; index++) {
+        if (extract_open(&playlist->segments[index].extract, playlist->segments[index].input) == 0)
+            break;
+        logging("playlist: skipping %s, it could not be opened", playlist->segments[index].input);
+    }
+    if (index == nb_inputs) {
+        logging("playlist: none of the %d segments could be opened", nb_inputs);
+        free(playlist->segments);
+        return -1;
+    }
+    PlaylistSegment *first = &playlist->segments[index];
+    first->opened = 1;
+    playlist->demux = playlist->decode = index;
+
+    // the timeline is expressed in the time base of the first segment and starts where it starts
+    const AVStream *stream = segment_stream(first);
+    playlist->time_base = stream->time_base;
+    playlist->offset = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    playlist->end = playlist->offset;
+
+    logging("playlist: %d segments, reading %s", nb_inputs, first->input);
+    start_prefetch(playlist, index + 1);
+    return 0;
+}
+
+ExtractContext *playlist_current(Playlist *playlist) {
+    return &playlist->segments[playlist->demux].extract;
+}
+
+int playlist_advance(Playlist *playlist) {
+    while (playlist->prefetch_index > playlist->demux) {
+        int next = playlist->prefetch_index;
+        if (playlist->prefetching) {
+            pthread_join(playlist->prefetch, NULL);
+            playlist->prefetching = 0;
+        }
+        playlist->prefetch_index = -1;
+        start_prefetch(playlist, next + 1);
+
+        if (playlist->segments[next].opened) {
+            playlist->demux = next;
+            logging("playlist: reading %s", playlist->segments[next].input);
+            return 0;
+        }
+        logging("playlist: skipping %s, it could not be opened", playlist->segments[next].input);
+    }
+    return -1;
+}
+
+const ExtractContext *playlist_next_decoder(Playlist *playlist) {
+    PlaylistSegment *done = &playlist->segments[playlist->decode];
+    playlist->frame_offset += done->extract.pCodecContext->frame_number;
+    playlist->offset = playlist->end;
+    extract_close(&done->extract);
+    done->opened = 0;
+
+    // the demuxer pushed the marker after this segment opened: the flags up to it are final
+    do
+        playlist->decode++;
+    while (!playlist->segments[playlist->decode].opened);
+    return &playlist->segments[playlist->decode].extract;
+}
+
+int playlist_frame(Playlist *playlist, AVFrame *pFrame, int frame_number) {
+    const AVStream *stream = segment_stream(&playlist->segments[playlist->decode]);
+    int64_t start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    int64_t *timestamps[] = { &pFrame->pts, &pFrame->pkt_dts, &pFrame->best_effort_timestamp };
+
+    for (int i = 0; i < 3; i++) {
+        if (*timestamps[i] != AV_NOPTS_VALUE)
+            *timestamps[i] = av_rescale_q(*timestamps[i] - start, stream->time_base, playlist->time_base) + playlist->offset;
+    }
+
+    // the next segment starts after the frame that ends last
+    if (pFrame->best_effort_timestamp != AV_NOPTS_VALUE) {
+        AVRational rate = stream->avg_frame_rate.num ? stream->avg_frame_rate : stream->r_frame_rate;
+        int64_t duration = 0;
+        if (pFrame->pkt_duration > 0)
+            duration = av_rescale_q(pFrame->pkt_duration, stream->time_base, playlist->time_base);
+        else if (rate.num > 0)
+            duration = av_rescale_q(1, (AVRational){ rate.den, rate.num }, playlist->time_base);
+        playlist->end = FFMAX(playlist->end, pFrame->best_effort_timestamp + duration);
+    }
+    return playlist->frame_offset + frame_number;
+}
+
+void playlist_close(Playlist *playlist) {
+    if (playlist->prefetching) {
+        pthread_join(playlist->prefetch, NULL);
+        playlist->prefetching = 0;
+    }
+    for (int i = 0; i < playlist->nb_segments; i++) {
+        if (playlist->segments[i].opened)
+            extract_close(&playlist->segments[i].extract);
+    }
+    free(playlist->segments);
+    playlist->segments = NULL;
+}
@@ -0,0 +1,115 @@
+/**
+ * @file playlist.h
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Several inputs played as one continuous timeline, for recordings split
+ * into numbered segments (part001.mpg, part002.mpg, ...). The demuxer reads
+ * the segments one after the other while the next one is opened and probed
+ * on a background thread, so its cold start overlaps the current decode.
+ *
+ * The end of a segment travels down the packet queue as a marker packet;
+ * when the decode thread reaches it, it drains the segment's decoder, closes
+ * the segment and continues with the next decoder. The last segment has no
+ * marker: the end-of-stream flush of the pipeline drains it, so its delayed
+ * frames and the end of the timeline are not lost. Frame numbers keep
+ * counting across segments, and the timestamps of every frame are moved
+ * onto the timeline: expressed in the time base of the first segment, each
+ * segment starting where the previous one ended.
+ *
+ * A segment that cannot be opened is skipped with a message, the first one
+ * included: the timeline starts with the first segment that opens.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef A3_PLAYLIST_H
+#define A3_PLAYLIST_H
+
+#include <pthread.h>
+
+#include "extract.h"
+
+/** stream_index of the packet marking the end of a segment in the packet queue */
+#define PLAYLIST_SEGMENT_END (-1)
+
+typedef struct PlaylistSegment {
+    const char *input;
+    ExtractContext extract;
+    int opened; // input and decoder open, until the decode thread is done with it
+} PlaylistSegment;
+
+typedef struct Playlist {
+    PlaylistSegment *segments;
+    int nb_segments;
+
+    // demux side (main thread)
+    int demux;         // segment being read
+    pthread_t prefetch;
+    int prefetching;   // a thread is opening segments[prefetch_index]
+    int prefetch_index;
+
+    // decode side (decode thread)
+    int decode;        // segment being decoded
+    int frame_offset;  // frames decoded in the previous segments
+    AVRational time_base; // of the first segment, the timeline uses it
+    int64_t offset;    // where the decoded segment starts on the timeline
+    int64_t end;       // end of the latest frame on the timeline
+} Playlist;
+
+/**
+ * @brief
+ * Open the first input that can be opened and start opening the next one in the background
+ * @param playlist
+ * @param inputs in timeline order
+ * @param nb_inputs
+ * @param options preset and export_motion_vectors of every segment
+ * @return int 0 on success, -1 if no input can be opened
+ */
+int playlist_open(Playlist *playlist, char *const *inputs, int nb_inputs, const ExtractContext *options);
+
+/**
+ * @brief
+ * The segment the demuxer reads
+ */
+ExtractContext *playlist_current(Playlist *playlist);
+
+/**
+ * @brief
+ * Demux side: move to the next segment that opened, waiting for the
+ * background open if it is still running, and start opening the one after
+ * @param playlist
+ * @return int 0 on success, -1 after the last segment
+ */
+int playlist_advance(Playlist *playlist);
+
+/**
+ * @brief
+ * Decode side, on a PLAYLIST_SEGMENT_END marker, once the decoder is drained:
+ * close the finished segment and return the next one
+ * @param playlist
+ * @return const ExtractContext*
+ */
+const ExtractContext *playlist_next_decoder(Playlist *playlist);
+
+/**
+ * @brief
+ * Decode side: move the timestamps of a decoded frame onto the timeline
+ * @param playlist
+ * @param pFrame
+ * @param frame_number of the frame in its segment's decoder
+ * @return int frame number on the timeline
+ */
+int playlist_frame(Playlist *playlist, AVFrame *pFrame, int frame_number);
+
+/**
+ * @brief
+ * Wait for a background open and close every segment still open
+ * @param playlist
+ */
+void playlist_close(Playlist *playlist);
+
+#endif
@@ -0,0 +1,121 @@
+/**
+ * @file qoi.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * QOI encoder, see qoi.h.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include <string.h>
+
+#include "qoi.h"
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF  0x40
+#define QOI_OP_LUMA  0x80
+#define QOI_OP_RUN   0xc0
+#define QOI_OP_RGB   0xfe
+
+#define QOI_HEADER_SIZE 14
+#define QOI_MAX_RUN 62
+
+static const uint8_t qoi_end_marker[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+
+size_t qoi_max_size(int width, int height) {
+    return (size_t)width * height * 4 + QOI_HEADER_SIZE + sizeof(qoi_end_marker);
+}
+
+static uint8_t *put_be32(uint8_t *p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+    return p + 4;
+}
+
+/**
+ * @brief
+ * Pixels as 0x00RRGGBB: one compare for the run and index tests. Alpha is
+ * always 255 for RGB input, so it is left out and folded into the hash.
+ */
+static inline uint32_t load_rgb(const uint8_t *p) {
+    return (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+}
+
+static inline unsigned qoi_hash(uint32_t px) {
+    return ((px >> 16) * 3 + (px >> 8 & 0xff) * 5 + (px & 0xff) * 7 + 255 * 11) & 63;
+}
+
+size_t qoi_encode_rgb(const uint8_t *rgb, int linesize, int width, int height, uint8_t *out) {
+    uint32_t index[64];
+    uint8_t *p = out;
+
+    memcpy(p, "qoif", 4);
+    p = put_be32(p + 4, width);
+    p = put_be32(p, height);
+    *p++ = 3; // channels
+    *p++ = 0; // sRGB with linear alpha
+
+    memset(index, 0, sizeof(index));
+    index[qoi_hash(0)] = 0xffffffff; // opaque black is not in the table yet, unlike the all-zero entries
+    uint32_t prev = 0; // the previous pixel starts as opaque black
+    int run = 0;
+
+    for (int y = 0; y < height; y++) {
+        const uint8_t *row = rgb + (size_t)y * linesize;
+        int x = 0;
+        while (x < width) {
+            // runs are the common case on flat areas: scan them without touching the table
+            if (load_rgb(row + 3 * x) == prev) {
+                do {
+                    x++;
+                    if (++run == QOI_MAX_RUN) {
+                        *p++ = QOI_OP_RUN | (run - 1);
+                        run = 0;
+                    }
+                } while (x < width && load_rgb(row + 3 * x) == prev);
+                continue;
+            }
+            if (run) {
+                *p++ = QOI_OP_RUN | (run - 1);
+                run = 0;
+            }
+
+            uint32_t px = load_rgb(row + 3 * x);
+            unsigned h = qoi_hash(px);
+            if (index[h] == px) {
+                *p++ = QOI_OP_INDEX | h;
+            } else {
+                index[h] = px;
+                int vr = (int8_t)((px >> 16) - (prev >> 16));
+                int vg = (int8_t)((px >> 8) - (prev >> 8));
+                int vb = (int8_t)(px - prev);
+                int vg_r = vr - vg, vg_b = vb - vg;
+
+                if ((unsigned)(vr + 2) < 4 && (unsigned)(vg + 2) < 4 && (unsigned)(vb + 2) < 4) {
+                    *p++ = QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2);
+                } else if ((unsigned)(vg + 32) < 64 && (unsigned)(vg_r + 8) < 16 && (unsigned)(vg_b + 8) < 16) {
+                    *p++ = QOI_OP_LUMA | (vg + 32);
+                    *p++ = (vg_r + 8) << 4 | (vg_b + 8);
+                } else {
+                    *p++ = QOI_OP_RGB;
+                    *p++ = px >> 16;
+                    *p++ = px >> 8;
+                    *p++ = px;
+                }
+            }
+            prev = px;
+            x++;
+        }
+    }
+    if (run)
+        *p++ = QOI_OP_RUN | (run - 1);
+
+    memcpy(p, qoi_end_marker, sizeof(qoi_end_marker));
+    return p + sizeof(qoi_end_marker) - out;
+}
@@ -0,0 +1,44 @@
+/**
+ * @file qoi.h
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Built-in encoder for the QOI lossless image format (https://qoiformat.org):
+ * a few times smaller than PPM on decoded video and far faster to encode
+ * than PNG, with no dependency. The encoder reads packed RGB24 rows straight
+ * from the converted frame in one pass.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef A3_QOI_H
+#define A3_QOI_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief
+ * Worst-case size of an encoded RGB image, header and end marker included
+ * @param width
+ * @param height
+ * @return size_t
+ */
+size_t qoi_max_size(int width, int height);
+
+/**
+ * @brief
+ * Encode an RGB24 image
+ * @param rgb first row, 3 bytes per pixel
+ * @param linesize bytes between rows
+ * @param width
+ * @param height
+ * @param out buffer of at least qoi_max_size(width, height) bytes
+ * @return size_t bytes written to out
+ */
+size_t qoi_encode_rgb(const uint8_t *rgb, int linesize, int width, int height, uint8_t *out);
+
+#endif
@@ -0,0 +1,350 @@
+/**
+ * @file queue.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Lock-free SPSC/MPMC rings with adaptive spin-then-futex waiting. See queue.h.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "queue.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#define QUEUE_SPIN_MIN 64
+#define QUEUE_SPIN_MAX 16384
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+static int online_cpus(void) {
+    static atomic_int ncpu;
+    int n = atomic_load_explicit(&ncpu, memory_order_relaxed);
+    if (!n) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n = cpus > 0 ? (int)cpus : 1;
+        atomic_store_explicit(&ncpu, n, memory_order_relaxed);
+    }
+    return n;
+}
+
+static void futex_wait(atomic_uint *word, unsigned expected) {
+#ifdef __linux__
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+#else
+    // no futex: back off briefly and let the caller re-check
+    struct timespec ts = { 0, 50 * 1000 };
+    if (atomic_load_explicit(word, memory_order_acquire) == expected)
+        nanosleep(&ts, NULL);
+#endif
+}
+
+static void futex_wake(atomic_uint *word, int count) {
+#ifdef __linux__
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+#else
+    (void)word;
+    (void)count;
+#endif
+}
+
+static void waiter_init(QueueWaiter *w) {
+    atomic_init(&w->seq, 0);
+    atomic_init(&w->sleepers, 0);
+    atomic_init(&w->spin_limit, QUEUE_SPIN_MIN);
+}
+
+/**
+ * @brief
+ * Wake sleepers of one queue direction. The fence pairs with the one in
+ * queue_block(): either the sleeper sees the new item on its last re-check,
+ * or we see it registered in sleepers and wake it. Clearing sleepers means
+ * only the first notify after a thread went to sleep pays for the syscall.
+ * @param w
+ */
+static void waiter_notify(QueueWaiter *w) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&w->sleepers, memory_order_relaxed) == 0 ||
+        atomic_exchange_explicit(&w->sleepers, 0, memory_order_relaxed) == 0)
+        return;
+    atomic_fetch_add_explicit(&w->seq, 1, memory_order_release);
+    futex_wake(&w->seq, INT_MAX);
+}
+
+typedef int (*QueueAttempt)(void *q, void **item);
+
+/**
+ * @brief
+ * Slow path shared by the blocking operations: spin on attempt() for the
+ * current adaptive limit, then sleep until the other side notifies. The spin
+ * limit doubles when spinning pays off and halves every time we had to sleep;
+ * on a single CPU spinning can never succeed, so we go straight to sleep.
+ * @param w waiter of the direction we are blocked on
+ * @param closed the queue's closed flag
+ * @param drain keep attempting after close (pop drains, push gives up)
+ * @param attempt non-blocking operation, returns 1 on success
+ * @param q
+ * @param item in/out item pointer passed to attempt
+ * @return int 0 on success, -1 when the queue was closed
+ */
+static int queue_block(QueueWaiter *w, atomic_int *closed, int drain, QueueAttempt attempt, void *q, void **item) {
+    unsigned limit = online_cpus() > 1 ? atomic_load_explicit(&w->spin_limit, memory_order_relaxed) : 0;
+    int slept = 0;
+
+    for (unsigned spins = 0;; spins++) {
+        if (!drain && atomic_load_explicit(closed, memory_order_acquire))
+            return -1;
+        if (attempt(q, item)) {
+            if (!slept && limit && limit < QUEUE_SPIN_MAX)
+                atomic_store_explicit(&w->spin_limit, limit * 2, memory_order_relaxed);
+            return 0;
+        }
+        if (atomic_load_explicit(closed, memory_order_acquire))
+            return attempt(q, item) ? 0 : -1;
+        if (spins < limit) {
+            cpu_relax();
+            continue;
+        }
+
+        unsigned seq = atomic_load_explicit(&w->seq, memory_order_acquire);
+        atomic_fetch_add_explicit(&w->sleepers, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (attempt(q, item))
+            return 0;
+        if (!atomic_load_explicit(closed, memory_order_acquire))
+            futex_wait(&w->seq, seq);
+
+        if (!slept && limit > QUEUE_SPIN_MIN)
+            atomic_store_explicit(&w->spin_limit, limit / 2, memory_order_relaxed);
+        slept = 1;
+        spins = 0;
+        limit = 0; // woken up: the item is either there now or someone else took it
+    }
+}
+
+static size_t round_up_pow2(size_t n) {
+    size_t p = 2;
+    while (p < n)
+        p <<= 1;
+    return p;
+}
+
+/* ---------------------------------------------------------------- SPSC */
+
+int spsc_queue_init(SpscQueue *q, size_t capacity) {
+    capacity = round_up_pow2(capacity);
+    q->slots = calloc(capacity, sizeof(*q->slots));
+    if (!q->slots)
+        return -1;
+    q->mask = capacity - 1;
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    q->head_cache = 0;
+    q->tail_cache = 0;
+    atomic_init(&q->closed, 0);
+    waiter_init(&q->not_empty);
+    waiter_init(&q->not_full);
+    return 0;
+}
+
+void spsc_queue_destroy(SpscQueue *q) {
+    free(q->slots);
+    q->slots = NULL;
+}
+
+static int spsc_attempt_push(void *queue, void **item) {
+    SpscQueue *q = queue;
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+    if (tail - q->head_cache > q->mask) {
+        q->head_cache = atomic_load_explicit(&q->head, memory_order_acquire);
+        if (tail - q->head_cache > q->mask)
+            return 0;
+    }
+    q->slots[tail & q->mask] = *item;
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+static int spsc_attempt_pop(void *queue, void **item) {
+    SpscQueue *q = queue;
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+
+    if (head == q->tail_cache) {
+        q->tail_cache = atomic_load_explicit(&q->tail, memory_order_acquire);
+        if (head == q->tail_cache)
+            return 0;
+    }
+    *item = q->slots[head & q->mask];
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return 1;
+}
+
+int spsc_queue_try_push(SpscQueue *q, void *item) {
+    if (!spsc_attempt_push(q, &item))
+        return -1;
+    waiter_notify(&q->not_empty);
+    return 0;
+}
+
+void *spsc_queue_try_pop(SpscQueue *q) {
+    void *item = NULL;
+    if (!spsc_attempt_pop(q, &item))
+        return NULL;
+    waiter_notify(&q->not_full);
+    return item;
+}
+
+int spsc_queue_push(SpscQueue *q, void *item) {
+    if (!spsc_attempt_push(q, &item) &&
+        queue_block(&q->not_full, &q->closed, 0, spsc_attempt_push, q, &item) < 0)
+        return -1;
+    waiter_notify(&q->not_empty);
+    return 0;
+}
+
+void *spsc_queue_pop(SpscQueue *q) {
+    void *item = NULL;
+    if (!spsc_attempt_pop(q, &item) &&
+        queue_block(&q->not_empty, &q->closed, 1, spsc_attempt_pop, q, &item) < 0)
+        return NULL;
+    waiter_notify(&q->not_full);
+    return item;
+}
+
+void spsc_queue_close(SpscQueue *q) {
+    atomic_store_explicit(&q->closed, 1, memory_order_release);
+    atomic_fetch_add_explicit(&q->not_empty.seq, 1, memory_order_release);
+    atomic_fetch_add_explicit(&q->not_full.seq, 1, memory_order_release);
+    futex_wake(&q->not_empty.seq, INT_MAX);
+    futex_wake(&q->not_full.seq, INT_MAX);
+}
+
+/* ---------------------------------------------------------------- MPMC */
+
+int mpmc_queue_init(MpmcQueue *q, size_t capacity) {
+    capacity = round_up_pow2(capacity);
+    q->cells = calloc(capacity, sizeof(*q->cells));
+    if (!q->cells)
+        return -1;
+    for (size_t i = 0; i < capacity; i++)
+        atomic_init(&q->cells[i].seq, i);
+    q->mask = capacity - 1;
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->closed, 0);
+    waiter_init(&q->not_empty);
+    waiter_init(&q->not_full);
+    return 0;
+}
+
+void mpmc_queue_destroy(MpmcQueue *q) {
+    free(q->cells);
+    q->cells = NULL;
+}
+
+static int mpmc_attempt_push(void *queue, void **item) {
+    MpmcQueue *q = queue;
+    size_t pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+    for (;;) {
+        MpmcCell *cell = &q->cells[pos & q->mask];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                cell->item = *item;
+                atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+                return 1;
+            }
+        } else if (dif < 0) {
+            return 0; // full
+        } else {
+            pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+        }
+    }
+}
+
+static int mpmc_attempt_pop(void *queue, void **item) {
+    MpmcQueue *q = queue;
+    size_t pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+
+    for (;;) {
+        MpmcCell *cell = &q->cells[pos & q->mask];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                *item = cell->item;
+                atomic_store_explicit(&cell->seq, pos + q->mask + 1, memory_order_release);
+                return 1;
+            }
+        } else if (dif < 0) {
+            return 0; // empty
+        } else {
+            pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+        }
+    }
+}
+
+int mpmc_queue_try_push(MpmcQueue *q, void *item) {
+    if (!mpmc_attempt_push(q, &item))
+        return -1;
+    waiter_notify(&q->not_empty);
+    return 0;
+}
+
+void *mpmc_queue_try_pop(MpmcQueue *q) {
+    void *item = NULL;
+    if (!mpmc_attempt_pop(q, &item))
+        return NULL;
+    waiter_notify(&q->not_full);
+    return item;
+}
+
+int mpmc_queue_push(MpmcQueue *q, void *item) {
+    if (!mpmc_attempt_push(q, &item) &&
+        queue_block(&q->not_full, &q->closed, 0, mpmc_attempt_push, q, &item) < 0)
+        return -1;
+    waiter_notify(&q->not_empty);
+    return 0;
+}
+
+void *mpmc_queue_pop(MpmcQueue *q) {
+    void *item = NULL;
+    if (!mpmc_attempt_pop(q, &item) &&
+        queue_block(&q->not_empty, &q->closed, 1, mpmc_attempt_pop, q, &item) < 0)
+        return NULL;
+    waiter_notify(&q->not_full);
+    return item;
+}
+
+void mpmc_queue_close(MpmcQueue *q) {
+    atomic_store_explicit(&q->closed, 1, memory_order_release);
+    atomic_fetch_add_explicit(&q->not_empty.seq, 1, memory_order_release);
+    atomic_fetch_add_explicit(&q->not_full.seq, 1, memory_order_release);
+    futex_wake(&q->not_empty.seq, INT_MAX);
+    futex_wake(&q->not_full.seq, INT_MAX);
+}
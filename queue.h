@@ -0,0 +1,116 @@
+/**
+ * @file queue.h
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Bounded lock-free ring queues used to hand packets and frames between the
+ * pipeline stages in A3.c:
+ *
+ *   demux --SpscQueue--> decode --MpmcQueue--> writer pool
+ *
+ * Items are opaque pointers (AVPacket *, FrameJob *, ...). Each index lives
+ * on its own cache line so producers and consumers never false-share. The
+ * blocking push/pop spin for an adaptive number of iterations and then sleep
+ * on a futex (a short nanosleep where futexes are not available).
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef A3_QUEUE_H
+#define A3_QUEUE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#define QUEUE_CACHE_LINE 64
+
+/**
+ * @brief
+ * Sleep/wake side of one queue direction (not-empty or not-full).
+ */
+typedef struct QueueWaiter {
+    _Alignas(QUEUE_CACHE_LINE) atomic_uint seq; // futex word, bumped on every notify
+    atomic_uint sleepers;
+    atomic_uint spin_limit;                     // adapted between QUEUE_SPIN_MIN and QUEUE_SPIN_MAX
+} QueueWaiter;
+
+/**
+ * @brief
+ * Single-producer single-consumer ring.
+ */
+typedef struct SpscQueue {
+    _Alignas(QUEUE_CACHE_LINE) atomic_size_t head; // next slot to pop, written by the consumer
+    size_t tail_cache;                             // consumer's last view of tail
+    _Alignas(QUEUE_CACHE_LINE) atomic_size_t tail; // next slot to push, written by the producer
+    size_t head_cache;                             // producer's last view of head
+    _Alignas(QUEUE_CACHE_LINE) void **slots;
+    size_t mask;
+    atomic_int closed;
+    QueueWaiter not_empty;
+    QueueWaiter not_full;
+} SpscQueue;
+
+typedef struct MpmcCell {
+    atomic_size_t seq;
+    void *item;
+} MpmcCell;
+
+/**
+ * @brief
+ * Multi-producer multi-consumer ring (bounded, per-cell sequence numbers).
+ */
+typedef struct MpmcQueue {
+    _Alignas(QUEUE_CACHE_LINE) atomic_size_t head;
+    _Alignas(QUEUE_CACHE_LINE) atomic_size_t tail;
+    _Alignas(QUEUE_CACHE_LINE) MpmcCell *cells;
+    size_t mask;
+    atomic_int closed;
+    QueueWaiter not_empty;
+    QueueWaiter not_full;
+} MpmcQueue;
+
+/**
+ * @brief
+ * Initialize a queue
+ * @param q
+ * @param capacity number of slots, rounded up to a power of two
+ * @return int 0 on success, -1 if the slots could not be allocated
+ */
+int spsc_queue_init(SpscQueue *q, size_t capacity);
+void spsc_queue_destroy(SpscQueue *q);
+
+/**
+ * @brief
+ * Non-blocking push / pop
+ * @return int 0 on success, -1 when the queue is full (push)
+ * @return void* the item, NULL when the queue is empty (pop)
+ */
+int spsc_queue_try_push(SpscQueue *q, void *item);
+void *spsc_queue_try_pop(SpscQueue *q);
+
+/**
+ * @brief
+ * Blocking push / pop. Push fails and pop returns NULL once the queue is
+ * closed (pop only after the remaining items are drained).
+ */
+int spsc_queue_push(SpscQueue *q, void *item);
+void *spsc_queue_pop(SpscQueue *q);
+
+/**
+ * @brief
+ * Mark the end of the stream and wake every blocked thread
+ */
+void spsc_queue_close(SpscQueue *q);
+
+int mpmc_queue_init(MpmcQueue *q, size_t capacity);
+void mpmc_queue_destroy(MpmcQueue *q);
+int mpmc_queue_try_push(MpmcQueue *q, void *item);
+void *mpmc_queue_try_pop(MpmcQueue *q);
+int mpmc_queue_push(MpmcQueue *q, void *item);
+void *mpmc_queue_pop(MpmcQueue *q);
+void mpmc_queue_close(MpmcQueue *q);
+
+#endif
@@ -0,0 +1,210 @@
+/**
+ * @file seek.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Exact-timestamp frame lookup with a seek/continue cost model, see seek.h.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include <libavutil/time.h>
+
+#include <math.h>
+#include <inttypes.h>
+
+#include "seek.h"
+
+#define SEEK_DEFAULT_GOP 12          // typical MPEG-2 GOP, used until two keyframes have been seen
+#define SEEK_INITIAL_DECODE_SEC 0.002
+#define SEEK_INITIAL_SEEK_SEC 0.010
+#define SEEK_AVERAGE_WEIGHT 0.2      // weight of a new measurement in the moving averages
+#define SEEK_MAX_RETRIES 3
+
+static void update_average(double *average, double sample) {
+    *average += SEEK_AVERAGE_WEIGHT * (sample - *average);
+}
+
+void frame_seeker_init(FrameSeeker *seeker, ExtractContext *extract) {
+    AVStream *stream = extract->pFormatContext->streams[extract->video_stream_index];
+    AVRational rate = stream->avg_frame_rate.num ? stream->avg_frame_rate : stream->r_frame_rate;
+
+    seeker->extract = extract;
+    seeker->stream = stream;
+    seeker->frame_duration = rate.num ? av_rescale_q(1, (AVRational){ rate.den, rate.num }, stream->time_base) : 1;
+    if (seeker->frame_duration < 1)
+        seeker->frame_duration = 1;
+    seeker->start_pts = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    seeker->position = AV_NOPTS_VALUE;
+    seeker->seek_started = 0;
+
+    seeker->model.decode_sec = SEEK_INITIAL_DECODE_SEC;
+    seeker->model.seek_sec = SEEK_INITIAL_SEEK_SEC;
+    seeker->model.gop_frames = SEEK_DEFAULT_GOP;
+    seeker->model.last_key_pts = AV_NOPTS_VALUE;
+    seeker->model.frames_since_key = -1;
+}
+
+const char *seek_strategy_name(SeekStrategy strategy) {
+    return strategy == SEEK_STRATEGY_SEEK ? "seek" : "continue";
+}
+
+/**
+ * @brief
+ * Decode one frame and feed the measurements into the model
+ * @param seeker
+ * @param pFrame
+ * @return int see extract_next_frame()
+ */
+static int decode_one(FrameSeeker *seeker, AVFrame *pFrame) {
+    SeekModel *model = &seeker->model;
+    int64_t start = av_gettime_relative();
+    int ret = extract_next_frame(seeker->extract, pFrame);
+    int64_t end = av_gettime_relative();
+    if (ret < 0)
+        return ret;
+
+    if (seeker->seek_started) {
+        // first frame after a seek: what it cost beyond a normal decode is the seek overhead
+        update_average(&model->seek_sec, FFMAX(0.0, (end - seeker->seek_started) / 1e6 - model->decode_sec));
+        seeker->seek_started = 0;
+    } else {
+        update_average(&model->decode_sec, (end - start) / 1e6);
+    }
+
+    int64_t pts = pFrame->best_effort_timestamp;
+    if (pts == AV_NOPTS_VALUE)
+        pts = seeker->position == AV_NOPTS_VALUE ? seeker->start_pts : seeker->position + seeker->frame_duration;
+    seeker->position = pts;
+
+    if (pFrame->key_frame) {
+        if (model->frames_since_key > 0)
+            update_average(&model->gop_frames, model->frames_since_key);
+        model->last_key_pts = pts;
+        model->frames_since_key = 0;
+    }
+    if (model->frames_since_key >= 0)
+        model->frames_since_key++;
+    return 0;
+}
+
+/**
+ * @brief
+ * Keyframe at or before target: exact from the demuxer index when there is
+ * one, otherwise extrapolated from the last keyframe seen and the GOP length
+ * @param seeker
+ * @param target
+ * @return int64_t
+ */
+static int64_t preceding_keyframe(FrameSeeker *seeker, int64_t target) {
+    int index = av_index_search_timestamp(seeker->stream, target, AVSEEK_FLAG_BACKWARD);
+    if (index >= 0) {
+        const AVIndexEntry *entry = avformat_index_get_entry(seeker->stream, index);
+        if (entry)
+            return entry->timestamp;
+    }
+
+    int64_t gop = FFMAX((int64_t)(seeker->model.gop_frames * seeker->frame_duration), seeker->frame_duration);
+    int64_t anchor = seeker->model.last_key_pts != AV_NOPTS_VALUE ? seeker->model.last_key_pts : seeker->start_pts;
+    if (target >= anchor)
+        return anchor + (target - anchor) / gop * gop;
+    return target - gop / 2; // no keyframe known behind target: expect it half a GOP back
+}
+
+/**
+ * @brief
+ * Predict the cost of both strategies and pick the cheaper one
+ * @param seeker
+ * @param target
+ * @param cost_continue predicted seconds, INFINITY if the decoder is already past target
+ * @param cost_seek predicted seconds
+ * @return SeekStrategy
+ */
+static SeekStrategy choose_strategy(FrameSeeker *seeker, int64_t target, double *cost_continue, double *cost_seek) {
+    const SeekModel *model = &seeker->model;
+    int64_t key = preceding_keyframe(seeker, target);
+    int64_t from = seeker->position != AV_NOPTS_VALUE ? seeker->position : seeker->start_pts - seeker->frame_duration;
+
+    *cost_seek = model->seek_sec + (double)(target - key) / seeker->frame_duration * model->decode_sec;
+
+    // the frame covering target has already been decoded (and handed out): only a seek gets it back
+    if (target < from + seeker->frame_duration) {
+        *cost_continue = INFINITY;
+        return SEEK_STRATEGY_SEEK;
+    }
+
+    *cost_continue = (double)(target - from) / seeker->frame_duration * model->decode_sec;
+    if (key <= from)
+        return SEEK_STRATEGY_CONTINUE; // the keyframe is behind us, seeking would redo decoded work
+    return *cost_continue <= *cost_seek ? SEEK_STRATEGY_CONTINUE : SEEK_STRATEGY_SEEK;
+}
+
+static int seek_to(FrameSeeker *seeker, int64_t ts) {
+    ExtractContext *extract = seeker->extract;
+    int64_t start = av_gettime_relative();
+
+    int ret = av_seek_frame(extract->pFormatContext, extract->video_stream_index, ts, AVSEEK_FLAG_BACKWARD);
+    if (ret < 0) {
+        logging("seek to pts %" PRId64 " failed: %s", ts, av_err2str(ret));
+        return ret;
+    }
+    avcodec_flush_buffers(extract->pCodecContext);
+    extract->draining = 0;
+
+    seeker->position = AV_NOPTS_VALUE;
+    seeker->seek_started = start;
+    seeker->model.frames_since_key = -1; // the GOP we land in is only counted from its keyframe
+    return 0;
+}
+
+/**
+ * @brief
+ * Decode forward until the frame covering target
+ * @return int 0 found, 1 the first frame decoded is already past target, <0 error
+ */
+static int decode_until(FrameSeeker *seeker, int64_t target, AVFrame *pFrame) {
+    for (int first = 1;; first = 0) {
+        int ret = decode_one(seeker, pFrame);
+        if (ret < 0)
+            return ret;
+
+        int64_t duration = pFrame->pkt_duration > 0 ? pFrame->pkt_duration : seeker->frame_duration;
+        if (seeker->position + duration > target)
+            return first && seeker->position > target ? 1 : 0;
+    }
+}
+
+int frame_seeker_get(FrameSeeker *seeker, double seconds, AVFrame *pFrame, SeekStrategy *strategy) {
+    int64_t target = seeker->start_pts + av_rescale_q(llrint(seconds * AV_TIME_BASE), AV_TIME_BASE_Q, seeker->stream->time_base);
+    double cost_continue, cost_seek;
+    SeekStrategy chosen = choose_strategy(seeker, target, &cost_continue, &cost_seek);
+    int ret;
+
+    logging("frame at %.3f s (pts %" PRId64 "): %s, predicted continue %.1f ms / seek %.1f ms",
+            seconds, target, seek_strategy_name(chosen), cost_continue * 1000, cost_seek * 1000);
+    if (strategy)
+        *strategy = chosen;
+
+    if (chosen == SEEK_STRATEGY_CONTINUE) {
+        ret = decode_until(seeker, target, pFrame);
+        return ret < 0 ? ret : 0;
+    }
+
+    // demuxers without an index land near, not exactly before, the target: back off and retry,
+    // then decode from the start of the stream
+    int64_t seek_ts = target;
+    for (int attempt = 0;; attempt++) {
+        if ((ret = seek_to(seeker, seek_ts)) < 0)
+            return ret;
+        ret = decode_until(seeker, target, pFrame);
+        if (ret != 1)
+            return ret;
+        if (seek_ts <= seeker->start_pts)
+            return 0; // target is before the first frame, which is the closest one there is
+        int64_t back_off = (int64_t)(seeker->model.gop_frames * seeker->frame_duration) << attempt;
+        seek_ts = attempt < SEEK_MAX_RETRIES ? FFMAX(seek_ts - back_off, seeker->start_pts) : seeker->start_pts;
+    }
+}
@@ -0,0 +1,73 @@
+/**
+ * @file seek.h
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Exact-timestamp frame lookup. For every requested time the seeker decides
+ * whether to keep decoding forward from the current decoder position or to
+ * seek to the preceding keyframe and decode from there, whichever the cost
+ * model predicts to be cheaper. The model is fed with what the seeker
+ * measures while it runs: decode time per frame, seek overhead and the
+ * distance between keyframes (GOP length).
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef A3_SEEK_H
+#define A3_SEEK_H
+
+#include "extract.h"
+
+typedef enum SeekStrategy {
+    SEEK_STRATEGY_CONTINUE, // decode forward from the current position
+    SEEK_STRATEGY_SEEK,     // seek to the preceding keyframe, then decode forward
+} SeekStrategy;
+
+/**
+ * @brief
+ * Running estimates the strategy choice is based on
+ */
+typedef struct SeekModel {
+    double decode_sec;   // decode time per frame (moving average)
+    double seek_sec;     // seek + decoder flush overhead, decoding excluded (moving average)
+    double gop_frames;   // frames between keyframes (moving average)
+    int64_t last_key_pts;
+    int64_t frames_since_key;
+} SeekModel;
+
+typedef struct FrameSeeker {
+    ExtractContext *extract;
+    AVStream *stream;
+    int64_t frame_duration; // in stream time base
+    int64_t start_pts;      // stream start, t = 0
+    int64_t position;       // pts of the last decoded frame, AV_NOPTS_VALUE if none yet
+    int64_t seek_started;   // av_gettime_relative() of a seek whose cost is not measured yet, 0 otherwise
+    SeekModel model;
+} FrameSeeker;
+
+/**
+ * @brief
+ * Attach a seeker to an opened extraction context
+ * @param seeker
+ * @param extract
+ */
+void frame_seeker_init(FrameSeeker *seeker, ExtractContext *extract);
+
+/**
+ * @brief
+ * Decode the frame displayed at the given time: the frame whose pts is at
+ * or before it and whose duration covers it
+ * @param seeker
+ * @param seconds time since the start of the stream
+ * @param pFrame receives the frame
+ * @param strategy receives the strategy used, may be NULL
+ * @return int 0 on success, AVERROR_EOF if the time is past the end, <0 on error
+ */
+int frame_seeker_get(FrameSeeker *seeker, double seconds, AVFrame *pFrame, SeekStrategy *strategy);
+
+const char *seek_strategy_name(SeekStrategy strategy);
+
+#endif
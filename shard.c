@@ -0,0 +1,318 @@
+/**
+ * @file shard.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Deterministic sharding of one input, see shard.h.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "governor.h"
+#include "seek.h"
+#include "shard.h"
+#include "writer.h"
+
+#define MANIFEST_MAGIC "a3-manifest 1"
+#define MANIFEST_LINE_SIZE 4096
+
+int shard_parse(const char *spec, int *index, int *count) {
+    char extra;
+    if (sscanf(spec, "%d/%d%c", index, count, &extra) != 2 || *count < 1 || *index < 0 || *index >= *count)
+        return -1;
+    return 0;
+}
+
+/**
+ * @brief
+ * Duration of the video stream in microseconds, -1 if unknown
+ */
+static int64_t stream_duration_us(const ExtractContext *extract) {
+    const AVStream *stream = extract->pFormatContext->streams[extract->video_stream_index];
+    if (stream->duration != AV_NOPTS_VALUE && stream->duration > 0)
+        return av_rescale_q(stream->duration, stream->time_base, AV_TIME_BASE_Q);
+    if (extract->pFormatContext->duration != AV_NOPTS_VALUE && extract->pFormatContext->duration > 0)
+        return extract->pFormatContext->duration;
+    return -1;
+}
+
+int shard_run(ExtractContext *extract, const char *input, int index, int count) {
+    AVStream *stream = extract->pFormatContext->streams[extract->video_stream_index];
+    int64_t duration = stream_duration_us(extract);
+    if (duration <= 0) {
+        logging("the duration of %s is unknown, it cannot be sharded", input);
+        return -1;
+    }
+
+    // shard boundaries in microseconds from the start of the stream, then in stream time base
+    int64_t start_us = av_rescale(index, duration, count);
+    int64_t end_us = index == count - 1 ? -1 : av_rescale(index + 1, duration, count);
+    int64_t start_pts = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    int64_t lo = index == 0 ? INT64_MIN : start_pts + av_rescale_q(start_us, AV_TIME_BASE_Q, stream->time_base);
+    int64_t hi = end_us < 0 ? INT64_MAX : start_pts + av_rescale_q(end_us, AV_TIME_BASE_Q, stream->time_base);
+
+    // frame n of the stream is the one displayed at (n - 1) / frame rate
+    AVRational rate = stream->avg_frame_rate.num ? stream->avg_frame_rate : stream->r_frame_rate;
+    double frames_per_tick = av_q2d(stream->time_base) * (rate.num > 0 && rate.den > 0 ? av_q2d(rate) : 25.0);
+
+    char filename[1024];
+    snprintf(filename, sizeof(filename), "shard-%d-of-%d.manifest", index, count);
+    FILE *manifest = fopen(filename, "w");
+    if (!manifest) {
+        logging("could not open %s", filename);
+        return -1;
+    }
+    fprintf(manifest, "%s\ninput %s\nshard %d %d\nrange %" PRId64 " %" PRId64 "\n", MANIFEST_MAGIC, input, index, count, start_us, end_us);
+
+    AVFrame *pFrame = av_frame_alloc();
+    if (!pFrame) {
+        logging("failed to allocate memory for AVFrame");
+        fclose(manifest);
+        return -1;
+    }
+
+    // position the decoder on the first frame of the range: keyframe seek, then decode forward
+    FrameSeeker seeker;
+    frame_seeker_init(&seeker, extract);
+    int response = index == 0 ? extract_next_frame(extract, pFrame) : frame_seeker_get(&seeker, start_us / 1e6, pFrame, NULL);
+
+    long written = 0, dropped = 0;
+    int write_error = 0;
+    int64_t last_number = 0, last_pts = AV_NOPTS_VALUE;
+    for (; response == 0; response = extract_next_frame(extract, pFrame)) {
+        // every frame needs a timestamp to fall in exactly one shard: fall back to the
+        // decoding timestamp, then to one frame after the previous frame
+        int64_t pts = pFrame->best_effort_timestamp;
+        if (pts == AV_NOPTS_VALUE)
+            pts = pFrame->pkt_dts;
+        if (pts == AV_NOPTS_VALUE && last_pts != AV_NOPTS_VALUE)
+            pts = last_pts + seeker.frame_duration;
+        if (pts == AV_NOPTS_VALUE) {
+            dropped++;
+            continue;
+        }
+        last_pts = pts;
+        if (pts >= hi)
+            break; // decoder output is in display order: the rest belongs to the next shard
+        if (pts < lo)
+            continue;
+
+        int64_t number = FFMAX(1, llrint((pts - start_pts) * frames_per_tick) + 1);
+        if (number <= last_number)
+            logging("frame at pts %" PRId64 " maps to frame-%" PRId64 " again, the frame rate is not constant", pts, number);
+        last_number = number;
+
+        governor_frame();
+        if (save_gray_frame(pFrame->data[0], pFrame->linesize[0], pFrame->width, pFrame->height, "frame", (int)number) < 0 ||
+            save_rgb_frame(pFrame, "frame", (int)number) < 0) {
+            logging("shard %d/%d: could not write frame-%" PRId64, index, count, number);
+            write_error = 1;
+            break;
+        }
+        fprintf(manifest, "frame %" PRId64 " %" PRId64 " frame-%" PRId64 ".pgm frame-%" PRId64 ".%s\n", number, pts, number, number, writer_rgb_extension());
+        written++;
+    }
+
+    if (dropped)
+        logging("shard %d/%d: dropped %ld frames without a timestamp", index, count, dropped);
+    int ret = write_error ? -1 : 0;
+    if (response < 0 && response != AVERROR_EOF) {
+        logging("shard %d/%d: decoding failed: %s", index, count, av_err2str(response));
+        ret = -1;
+    }
+    if (ret == 0)
+        fprintf(manifest, "end %ld\n", written); // only complete fragments get an end line
+    if (fclose(manifest) != 0)
+        ret = -1;
+    av_frame_free(&pFrame);
+
+    if (end_us < 0)
+        logging("shard %d/%d: %ld frames from %.3f s to the end, manifest %s", index, count, written, start_us / 1e6, filename);
+    else
+        logging("shard %d/%d: %ld frames in [%.3f s, %.3f s), manifest %s", index, count, written, start_us / 1e6, end_us / 1e6, filename);
+    return ret;
+}
+
+/* ---------------------------------------------------------------- merge */
+
+typedef struct Fragment {
+    const char *path;
+    char input[MANIFEST_LINE_SIZE];
+    int index, count;
+    int64_t start_us, end_us;
+    long declared;      // from the end line, -1 if missing
+    char **frames;      // frame lines
+    int64_t *numbers;
+    long nb_frames;
+} Fragment;
+
+static void fragment_free(Fragment *f) {
+    for (long i = 0; i < f->nb_frames; i++)
+        free(f->frames[i]);
+    free(f->frames);
+    free(f->numbers);
+}
+
+static int fragment_read(Fragment *f, const char *path) {
+    char line[MANIFEST_LINE_SIZE];
+    long capacity = 0;
+    FILE *in = fopen(path, "r");
+
+    memset(f, 0, sizeof(*f));
+    f->path = path;
+    f->index = f->count = -1;
+    f->declared = -1;
+    if (!in) {
+        logging("merge: could not open %s", path);
+        return -1;
+    }
+
+    int ret = 0;
+    if (!fgets(line, sizeof(line), in) || strncmp(line, MANIFEST_MAGIC, strlen(MANIFEST_MAGIC)) != 0) {
+        logging("merge: %s is not a manifest", path);
+        ret = -1;
+    }
+    while (ret == 0 && fgets(line, sizeof(line), in)) {
+        line[strcspn(line, "\n")] = 0;
+        int64_t number, pts;
+
+        if (!strncmp(line, "input ", 6)) {
+            snprintf(f->input, sizeof(f->input), "%s", line + 6);
+        } else if (sscanf(line, "shard %d %d", &f->index, &f->count) == 2) {
+        } else if (sscanf(line, "range %" SCNd64 " %" SCNd64, &f->start_us, &f->end_us) == 2) {
+        } else if (sscanf(line, "frame %" SCNd64 " %" SCNd64, &number, &pts) == 2) {
+            if (f->nb_frames == capacity) {
+                capacity = capacity ? capacity * 2 : 1024;
+                char **frames = realloc(f->frames, capacity * sizeof(*frames));
+                int64_t *numbers = realloc(f->numbers, capacity * sizeof(*numbers));
+                if (frames)
+                    f->frames = frames;
+                if (numbers)
+                    f->numbers = numbers;
+                if (!frames || !numbers) {
+                    ret = -1;
+                    break;
+                }
+            }
+            if (!(f->frames[f->nb_frames] = strdup(line))) {
+                ret = -1;
+                break;
+            }
+            f->numbers[f->nb_frames++] = number;
+        } else if (sscanf(line, "end %ld", &f->declared) == 1) {
+        } else if (line[0]) {
+            logging("merge: %s: unexpected line '%s'", path, line);
+            ret = -1;
+        }
+    }
+    fclose(in);
+
+    if (ret == 0 && (f->index < 0 || f->count < 1)) {
+        logging("merge: %s has no shard line", path);
+        ret = -1;
+    }
+    if (ret == 0 && f->declared != f->nb_frames) {
+        logging("merge: %s is incomplete (shard %d/%d did not finish)", path, f->index, f->count);
+        ret = -1;
+    }
+    return ret;
+}
+
+static int compare_fragments(const void *a, const void *b) {
+    const Fragment *fa = a, *fb = b;
+    return (fa->index > fb->index) - (fa->index < fb->index);
+}
+
+/**
+ * @brief
+ * Check that the sorted fragments are one complete, consistent sharding
+ */
+static int fragments_validate(const Fragment *f, int nb) {
+    int count = f[0].count;
+    if (count != nb) {
+        logging("merge: %d fragments given for %d shards", nb, count);
+        return -1;
+    }
+
+    int64_t last_number = 0;
+    for (int i = 0; i < nb; i++) {
+        if (f[i].count != count || strcmp(f[i].input, f[0].input) != 0) {
+            logging("merge: %s belongs to another sharding (%s, %d shards)", f[i].path, f[i].input, f[i].count);
+            return -1;
+        }
+        if (f[i].index != i) {
+            logging("merge: shard %d is %s", i, f[i].index < i ? "given twice" : "missing");
+            return -1;
+        }
+        int64_t expected_start = i == 0 ? 0 : f[i - 1].end_us;
+        if (f[i].start_us != expected_start || (i == nb - 1) != (f[i].end_us == -1)) {
+            logging("merge: the range of shard %d does not continue the previous one", i);
+            return -1;
+        }
+        for (long k = 0; k < f[i].nb_frames; k++) {
+            int64_t number = f[i].numbers[k];
+            if (number <= last_number) {
+                logging("merge: frame-%" PRId64 " of shard %d overlaps earlier output", number, i);
+                return -1;
+            }
+            if (k == 0 && i > 0 && number != last_number + 1)
+                logging("merge: warning: no frames %" PRId64 "-%" PRId64 " at the start of shard %d", last_number + 1, number - 1, i);
+            last_number = number;
+        }
+    }
+    return 0;
+}
+
+int shard_merge(const char *output, char *const *fragments, int nb_fragments) {
+    if (nb_fragments < 1) {
+        logging("merge: no manifest fragments given");
+        return -1;
+    }
+    Fragment *f = calloc(nb_fragments, sizeof(*f));
+    if (!f)
+        return -1;
+
+    int ret = 0, nb_read = 0;
+    for (; nb_read < nb_fragments && ret == 0; nb_read++)
+        ret = fragment_read(&f[nb_read], fragments[nb_read]);
+
+    if (ret == 0) {
+        qsort(f, nb_fragments, sizeof(*f), compare_fragments);
+        ret = fragments_validate(f, nb_fragments);
+    }
+
+    if (ret == 0) {
+        FILE *out = fopen(output, "w");
+        long total = 0;
+        if (!out) {
+            logging("merge: could not open %s", output);
+            ret = -1;
+        } else {
+            fprintf(out, "%s\ninput %s\nshard 0 1\nrange 0 -1\n", MANIFEST_MAGIC, f[0].input);
+            for (int i = 0; i < nb_fragments; i++) {
+                for (long k = 0; k < f[i].nb_frames; k++)
+                    fprintf(out, "%s\n", f[i].frames[k]);
+                total += f[i].nb_frames;
+            }
+            fprintf(out, "end %ld\n", total);
+            if (fclose(out) != 0)
+                ret = -1;
+            else
+                logging("merge: %d shards, %ld frames -> %s", nb_fragments, total, output);
+        }
+    }
+
+    for (int i = 0; i < nb_read; i++)
+        fragment_free(&f[i]);
+    free(f);
+    return ret;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file shard.h
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Deterministic sharding of one input across processes or nodes. The
+ * duration of the video stream is cut into N equal time ranges; shard i
+ * seeks to the keyframe before its range, decodes up to the end of it and
+ * saves the frames whose timestamp falls inside. Frames are numbered from
+ * their timestamp (frame-<n> is the n-th frame of the stream), so the outputs
+ * of N shards are named exactly as those of a single --shard 0/1 run.
+ *
+ * Every shard writes a manifest fragment, shard-<i>-of-<N>.manifest:
+ *
+ *   a3-manifest 1
+ *   input <path>
+ *   shard <i> <N>
+ *   range <start_us> <end_us>     (end -1: up to the end of the stream)
+ *   frame <n> <pts> <pgm file> <ppm file>
+ *   ...
+ *   end <number of frame lines>
+ *
+ * shard_merge() checks that the fragments cover every shard exactly once
+ * with contiguous ranges and stitches them into one manifest.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef A3_SHARD_H
+#define A3_SHARD_H
+
+#include "extract.h"
+
+/**
+ * @brief
+ * Parse "i/N"
+ * @param spec
+ * @param index receives i, 0 <= i < N
+ * @param count receives N
+ * @return int 0 on success, -1 if malformed
+ */
+int shard_parse(const char *spec, int *index, int *count);
+
+/**
+ * @brief
+ * Extract the frames of one shard and write its manifest fragment
+ * @param extract opened input (decoder open)
+ * @param input path recorded in the manifest
+ * @param index
+ * @param count
+ * @return int 0 on success, -1 on failure
+ */
+int shard_run(ExtractContext *extract, const char *input, int index, int count);
+
+/**
+ * @brief
+ * Validate coverage and merge manifest fragments, in any order
+ * @param output merged manifest path
+ * @param fragments fragment paths
+ * @param nb_fragments
+ * @return int 0 on success, -1 if the fragments are inconsistent or incomplete
+ */
+int shard_merge(const char *output, char *const *fragments, int nb_fragments);
+
+#endif
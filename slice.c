@@ -0,0 +1,227 @@
+/**
+ * @file slice.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Band-parallel colour conversion, see slice.h.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include <libavutil/common.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+
+#include "convert.h"
+#include "slice.h"
+
+#define SLICE_MAX_THREADS 64
+#define SLICE_MIN_PIXELS (1920 * 1080) // below this, waking the pool costs more than it saves
+#define SLICE_MIN_ROWS 32
+
+/**
+ * @brief
+ * One slice_run() call; lives on the caller's stack until every worker let go of it
+ */
+typedef struct SliceJob {
+    SliceFunc func;
+    void *arg;
+    int nb_bands;
+    atomic_int next; // next band to claim
+    atomic_int done; // bands finished
+    int workers;     // pool threads still inside the job, under the pool lock
+} SliceJob;
+
+typedef struct SlicePool {
+    pthread_mutex_t lock;
+    pthread_cond_t start;    // a job was posted
+    pthread_cond_t finished; // a worker left the job
+    SliceJob *job;           // current job, NULL between jobs
+    int nb_threads;          // pool threads, the caller excluded
+    pthread_mutex_t busy;    // held by the thread whose job the pool runs
+} SlicePool;
+
+static SlicePool pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .start = PTHREAD_COND_INITIALIZER,
+    .finished = PTHREAD_COND_INITIALIZER,
+    .busy = PTHREAD_MUTEX_INITIALIZER,
+};
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+static void run_bands(SliceJob *job) {
+    int band;
+    while ((band = atomic_fetch_add(&job->next, 1)) < job->nb_bands) {
+        job->func(job->arg, band, job->nb_bands);
+        atomic_fetch_add(&job->done, 1);
+    }
+}
+
+static void *pool_thread(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&pool.lock);
+    for (;;) {
+        while (!pool.job)
+            pthread_cond_wait(&pool.start, &pool.lock);
+        SliceJob *job = pool.job;
+        job->workers++;
+        pthread_mutex_unlock(&pool.lock);
+
+        run_bands(job);
+
+        pthread_mutex_lock(&pool.lock);
+        if (pool.job == job)
+            pool.job = NULL; // every band is claimed: nobody else needs to join
+        job->workers--;
+        pthread_cond_broadcast(&pool.finished);
+    }
+    return NULL;
+}
+
+static void pool_start(void) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int wanted = cores > SLICE_MAX_THREADS ? SLICE_MAX_THREADS - 1 : (int)cores - 1;
+    for (pool.nb_threads = 0; pool.nb_threads < wanted; pool.nb_threads++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, pool_thread, NULL) != 0)
+            break;
+        pthread_detach(thread);
+    }
+}
+
+void slice_run(SliceFunc func, void *arg, int nb_bands) {
+    SliceJob job = { .func = func, .arg = arg, .nb_bands = nb_bands };
+    atomic_init(&job.next, 0);
+    atomic_init(&job.done, 0);
+
+    pthread_once(&pool_once, pool_start);
+    if (nb_bands <= 1 || pool.nb_threads == 0 || pthread_mutex_trylock(&pool.busy) != 0) {
+        run_bands(&job); // nothing to share, or the pool is working for another frame
+        return;
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    pool.job = &job;
+    pthread_cond_broadcast(&pool.start);
+    pthread_mutex_unlock(&pool.lock);
+
+    run_bands(&job);
+
+    pthread_mutex_lock(&pool.lock);
+    if (pool.job == &job)
+        pool.job = NULL;
+    while (job.workers > 0 || atomic_load(&job.done) < nb_bands)
+        pthread_cond_wait(&pool.finished, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+    pthread_mutex_unlock(&pool.busy);
+}
+
+int slice_auto_bands(int width, int height) {
+    pthread_once(&pool_once, pool_start);
+    if ((long)width * height < SLICE_MIN_PIXELS)
+        return 1;
+    return FFMAX(1, FFMIN(pool.nb_threads + 1, height / SLICE_MIN_ROWS));
+}
+
+/**
+ * @brief
+ * Rows [*y0, *y1) of band, band starts aligned on 1 << log2_chroma_h
+ */
+static void band_rows(int height, int log2_chroma_h, int band, int nb_bands, int *y0, int *y1) {
+    int align = 1 << log2_chroma_h;
+    int rows = (height + nb_bands - 1) / nb_bands;
+    rows = (rows + align - 1) / align * align;
+    *y0 = FFMIN(height, band * rows);
+    *y1 = FFMIN(height, *y0 + rows);
+}
+
+/**
+ * @brief
+ * Source plane pointers moved down to row y (a multiple of the chroma subsampling)
+ */
+static void offset_planes(const AVFrame *frame, int log2_chroma_h, int y, const uint8_t *planes[4]) {
+    for (int p = 0; p < 4; p++) {
+        int shift = p == 1 || p == 2 ? log2_chroma_h : 0;
+        planes[p] = frame->data[p] ? frame->data[p] + (ptrdiff_t)(y >> shift) * frame->linesize[p] : NULL;
+    }
+}
+
+typedef struct ConvertBands {
+    const Converter *conv;
+    const YuvCoeffs *coeffs;
+    const AVFrame *src;
+    AVFrame *dst;
+} ConvertBands;
+
+static void convert_band(void *arg, int band, int nb_bands) {
+    ConvertBands *bands = arg;
+    const uint8_t *planes[4];
+    int y0, y1;
+
+    band_rows(bands->src->height, bands->conv->log2_chroma_h, band, nb_bands, &y0, &y1);
+    if (y0 >= y1)
+        return;
+    offset_planes(bands->src, bands->conv->log2_chroma_h, y0, planes);
+    bands->conv->convert(planes, bands->src->linesize, bands->dst->data[0] + (ptrdiff_t)y0 * bands->dst->linesize[0],
+                         bands->dst->linesize[0], bands->src->width, y1 - y0, bands->coeffs);
+}
+
+int slice_convert_frame(const AVFrame *src, AVFrame *dst, int nb_bands) {
+    ConvertBands bands = { .conv = converter_find(src->format, dst->format), .src = src, .dst = dst };
+    if (!bands.conv)
+        return -1;
+    bands.coeffs = converter_coeffs(bands.conv, src);
+    slice_run(convert_band, &bands, nb_bands > 0 ? nb_bands : slice_auto_bands(src->width, src->height));
+    return 0;
+}
+
+typedef struct ScaleBands {
+    const AVFrame *src;
+    AVFrame *dst;
+    int log2_chroma_h;     // of the source
+    int dst_log2_chroma_h; // of the destination
+    int flags;
+    atomic_int failed;
+} ScaleBands;
+
+static void scale_band(void *arg, int band, int nb_bands) {
+    ScaleBands *bands = arg;
+    const AVFrame *src = bands->src;
+    AVFrame *dst = bands->dst;
+    const uint8_t *src_planes[4], *dst_planes[4];
+    int y0, y1;
+
+    band_rows(src->height, FFMAX(bands->log2_chroma_h, bands->dst_log2_chroma_h), band, nb_bands, &y0, &y1);
+    if (y0 >= y1)
+        return;
+
+    struct SwsContext *ctx = sws_getContext(src->width, y1 - y0, src->format, dst->width, y1 - y0, dst->format, bands->flags, NULL, NULL, NULL);
+    if (!ctx) {
+        atomic_store(&bands->failed, 1);
+        return;
+    }
+    offset_planes(src, bands->log2_chroma_h, y0, src_planes);
+    offset_planes(dst, bands->dst_log2_chroma_h, y0, dst_planes);
+    sws_scale(ctx, src_planes, src->linesize, 0, y1 - y0, (uint8_t *const *)dst_planes, dst->linesize);
+    sws_freeContext(ctx);
+}
+
+int slice_scale_frame(const AVFrame *src, AVFrame *dst, int nb_bands, int flags) {
+    const AVPixFmtDescriptor *src_desc = av_pix_fmt_desc_get(src->format);
+    const AVPixFmtDescriptor *dst_desc = av_pix_fmt_desc_get(dst->format);
+    if (!src_desc || !dst_desc || src->width != dst->width || src->height != dst->height)
+        return -1;
+
+    ScaleBands bands = { .src = src, .dst = dst, .log2_chroma_h = src_desc->log2_chroma_h,
+                         .dst_log2_chroma_h = dst_desc->log2_chroma_h, .flags = flags };
+    atomic_init(&bands.failed, 0);
+    slice_run(scale_band, &bands, nb_bands > 0 ? nb_bands : slice_auto_bands(src->width, src->height));
+    return atomic_load(&bands.failed) ? -1 : 0;
+}
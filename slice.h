@@ -0,0 +1,75 @@
+/**
+ * @file slice.h
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Intra-frame parallelism for the colour conversion. One frame is cut into
+ * horizontal bands whose first rows are aligned on the chroma subsampling,
+ * so every band is a self-contained picture. The bands run on a small
+ * process-wide thread pool, the calling thread included, and the call
+ * returns when the whole frame is converted. This lowers the latency of a
+ * single large frame; when the pool is already busy with another frame
+ * (several writer threads), the caller converts its bands alone, since the
+ * frames themselves are then the parallelism.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef A3_SLICE_H
+#define A3_SLICE_H
+
+#include <libavutil/frame.h>
+
+/**
+ * @brief
+ * Work for one band
+ * @param arg
+ * @param band 0 .. nb_bands - 1
+ * @param nb_bands
+ */
+typedef void (*SliceFunc)(void *arg, int band, int nb_bands);
+
+/**
+ * @brief
+ * Run func for every band, in parallel on the pool, and wait for all of them
+ * @param func
+ * @param arg
+ * @param nb_bands
+ */
+void slice_run(SliceFunc func, void *arg, int nb_bands);
+
+/**
+ * @brief
+ * Number of bands worth using for a picture of that size: one per thread of
+ * the pool, or 1 for pictures too small to gain from it
+ * @param width
+ * @param height
+ * @return int
+ */
+int slice_auto_bands(int width, int height);
+
+/**
+ * @brief
+ * convert_frame() (convert.h) in bands: one kernel call per band
+ * @param src
+ * @param dst allocated at the size of src
+ * @param nb_bands 0 for slice_auto_bands()
+ * @return int 0 on success, -1 when no kernel exists for the pair
+ */
+int slice_convert_frame(const AVFrame *src, AVFrame *dst, int nb_bands);
+
+/**
+ * @brief
+ * swscale conversion without resizing, in bands: one SwsContext per band
+ * @param src
+ * @param dst allocated at the size of src
+ * @param nb_bands 0 for slice_auto_bands()
+ * @param flags SWS_* flags
+ * @return int 0 on success, -1 if the sizes differ or a context cannot be created
+ */
+int slice_scale_frame(const AVFrame *src, AVFrame *dst, int nb_bands, int flags);
+
+#endif
@@ -0,0 +1,372 @@
+/**
+ * @file supervisor.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Multi-process job coordinator with crash recovery, see supervisor.h.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <libavutil/time.h>
+
+#include "extract.h"
+#include "governor.h"
+#include "supervisor.h"
+#include "writer.h"
+
+#define QUEUE_PATH_SIZE 1024
+#define PROGRESS_INTERVAL_US 5000000
+
+static const char *const queue_states[] = { "pending", "running", "done", "failed", "out" };
+
+/**
+ * @brief
+ * Counters shared by the supervisor and its workers (anonymous shared mapping)
+ */
+typedef struct SupervisorStats {
+    atomic_long jobs_done;
+    atomic_long jobs_failed;
+    atomic_long retries;
+    atomic_long frames;
+} SupervisorStats;
+
+static int queue_path(char *buf, const char *queue, const char *state, const char *name) {
+    int n = snprintf(buf, QUEUE_PATH_SIZE, "%s/%s/%s", queue, state, name);
+    return n < 0 || n >= QUEUE_PATH_SIZE ? -1 : 0;
+}
+
+static int make_dir(const char *path) {
+    if (mkdir(path, 0755) < 0 && errno != EEXIST) {
+        logging("could not create %s: %s", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static int queue_create(const char *queue) {
+    char path[QUEUE_PATH_SIZE];
+    if (make_dir(queue) < 0)
+        return -1;
+    for (size_t i = 0; i < sizeof(queue_states) / sizeof(queue_states[0]); i++) {
+        if (queue_path(path, queue, queue_states[i], "") < 0 || make_dir(path) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+int supervisor_enqueue(const char *queue, char *const *inputs, int nb_inputs) {
+    char tmp[QUEUE_PATH_SIZE], path[QUEUE_PATH_SIZE], name[64];
+    if (queue_create(queue) < 0)
+        return -1;
+
+    int64_t stamp = av_gettime();
+    for (int i = 0; i < nb_inputs; i++) {
+        // ids sort in submission order; the file is published by rename so a worker never reads it half written
+        snprintf(name, sizeof(name), "%016" PRId64 "-%06d.0", stamp, i);
+        if (queue_path(path, queue, "pending", name) < 0 || snprintf(tmp, sizeof(tmp), "%s/.%s", queue, name) >= (int)sizeof(tmp))
+            return -1;
+        FILE *job = fopen(tmp, "w");
+        if (!job) {
+            logging("could not create %s: %s", tmp, strerror(errno));
+            return -1;
+        }
+        fprintf(job, "%s\n", inputs[i]);
+        if (fclose(job) != 0 || rename(tmp, path) < 0) {
+            logging("could not queue %s: %s", inputs[i], strerror(errno));
+            return -1;
+        }
+    }
+    if (nb_inputs > 0)
+        logging("%d jobs queued in %s", nb_inputs, queue);
+    return 0;
+}
+
+/**
+ * @brief
+ * Split "<id>.<attempt>[@<pid>]" in place
+ * @return int 0 on success, -1 if the name is not a job
+ */
+static int job_parse(char *name, int *attempt, pid_t *pid) {
+    char *at = strchr(name, '@');
+    *pid = 0;
+    if (at) {
+        *at = 0;
+        *pid = (pid_t)strtol(at + 1, NULL, 10);
+    }
+    char *dot = strrchr(name, '.');
+    if (!dot || dot == name)
+        return -1;
+    *dot = 0;
+    *attempt = (int)strtol(dot + 1, NULL, 10);
+    return 0;
+}
+
+/**
+ * @brief
+ * Number of jobs waiting in pending/
+ */
+static int queue_pending(const char *queue) {
+    char path[QUEUE_PATH_SIZE];
+    int count = 0;
+    queue_path(path, queue, "pending", "");
+    DIR *dir = opendir(path);
+    if (!dir)
+        return 0;
+    for (struct dirent *entry; (entry = readdir(dir));) {
+        if (entry->d_name[0] != '.')
+            count++;
+    }
+    closedir(dir);
+    return count;
+}
+
+/**
+ * @brief
+ * Claim the oldest pending job for this process
+ * @param queue
+ * @param claimed receives the name in running/
+ * @return int 1 if a job was claimed, 0 if the queue is empty
+ */
+static int job_claim(const char *queue, char *claimed) {
+    char path[QUEUE_PATH_SIZE], target[QUEUE_PATH_SIZE], oldest[256];
+    queue_path(path, queue, "pending", "");
+
+    for (;;) {
+        DIR *dir = opendir(path);
+        if (!dir)
+            return 0;
+        oldest[0] = 0;
+        for (struct dirent *entry; (entry = readdir(dir));) {
+            if (entry->d_name[0] != '.' && strlen(entry->d_name) < sizeof(oldest) && (!oldest[0] || strcmp(entry->d_name, oldest) < 0))
+                snprintf(oldest, sizeof(oldest), "%s", entry->d_name);
+        }
+        closedir(dir);
+        if (!oldest[0])
+            return 0;
+
+        snprintf(claimed, 256, "%s@%d", oldest, (int)getpid());
+        queue_path(path, queue, "pending", oldest);
+        queue_path(target, queue, "running", claimed);
+        if (rename(path, target) == 0)
+            return 1;
+        queue_path(path, queue, "pending", ""); // another worker won this one, look again
+    }
+}
+
+/**
+ * @brief
+ * Extract every frame of the job's input into out/<id>/
+ * @return long number of frames, -1 on failure (including a frame that could not be written)
+ */
+static long job_run(const char *queue, const char *running, const char *id, AVFrame *pFrame) {
+    char path[QUEUE_PATH_SIZE], input[QUEUE_PATH_SIZE], prefix[QUEUE_PATH_SIZE];
+
+    queue_path(path, queue, "running", running);
+    FILE *job = fopen(path, "r");
+    if (!job || !fgets(input, sizeof(input), job)) {
+        if (job)
+            fclose(job);
+        return -1;
+    }
+    fclose(job);
+    input[strcspn(input, "\n")] = 0;
+
+    if (queue_path(path, queue, "out", id) < 0 || make_dir(path) < 0 || snprintf(prefix, sizeof(prefix), "%s/frame", path) >= (int)sizeof(prefix))
+        return -1;
+
+    ExtractContext extract = { .video_stream_index = -1 };
+    if (extract_open(&extract, input) < 0)
+        return -1;
+
+    long frames = 0;
+    int response;
+    while ((response = extract_next_frame(&extract, pFrame)) == 0) {
+        frames++;
+        governor_frame();
+        int ret = save_gray_frame(pFrame->data[0], pFrame->linesize[0], pFrame->width, pFrame->height, prefix, (int)frames);
+        if (ret == 0)
+            ret = save_rgb_frame(pFrame, prefix, (int)frames);
+        av_frame_unref(pFrame);
+        if (ret < 0) {
+            response = ret;
+            break;
+        }
+    }
+    extract_close(&extract);
+    return response == AVERROR_EOF ? frames : -1;
+}
+
+/**
+ * @brief
+ * Worker process: claim and run jobs until the queue is empty
+ */
+static void worker_main(const char *queue, SupervisorStats *stats) {
+    char running[256], id[256], path[QUEUE_PATH_SIZE], target[QUEUE_PATH_SIZE];
+    AVFrame *pFrame = av_frame_alloc(); // reused by every job of this worker
+    if (!pFrame)
+        exit(EXIT_FAILURE);
+
+    while (job_claim(queue, running)) {
+        int attempt;
+        pid_t pid;
+        snprintf(id, sizeof(id), "%s", running);
+        job_parse(id, &attempt, &pid);
+
+        governor_apply_priority(); // nice and I/O class may have been changed while the batch runs
+        int64_t started = av_gettime_relative();
+        long frames = job_run(queue, running, id, pFrame);
+
+        queue_path(path, queue, "running", running);
+        FILE *job = fopen(path, "a");
+        if (job) {
+            fprintf(job, "frames %ld\nseconds %.3f\n", frames, (av_gettime_relative() - started) / 1e6);
+            fclose(job);
+        }
+        queue_path(target, queue, frames < 0 ? "failed" : "done", id);
+        if (rename(path, target) < 0)
+            logging("could not move %s: %s", path, strerror(errno));
+
+        if (frames < 0) {
+            atomic_fetch_add(&stats->jobs_failed, 1);
+        } else {
+            atomic_fetch_add(&stats->jobs_done, 1);
+            atomic_fetch_add(&stats->frames, frames);
+        }
+    }
+    av_frame_free(&pFrame);
+    exit(EXIT_SUCCESS);
+}
+
+/**
+ * @brief
+ * Move the jobs a dead worker held back to pending/, or to failed/ past the retry limit
+ * @param queue
+ * @param owner pid of the dead worker, 0 for every job whose worker no longer exists
+ */
+static void queue_requeue(const char *queue, pid_t owner, int max_retries, SupervisorStats *stats) {
+    char path[QUEUE_PATH_SIZE], target[QUEUE_PATH_SIZE], name[256], requeued[256];
+    queue_path(path, queue, "running", "");
+    DIR *dir = opendir(path);
+    if (!dir)
+        return;
+
+    for (struct dirent *entry; (entry = readdir(dir));) {
+        int attempt;
+        pid_t pid;
+        if (entry->d_name[0] == '.' || strlen(entry->d_name) >= sizeof(name))
+            continue;
+        snprintf(name, sizeof(name), "%s", entry->d_name);
+        if (job_parse(name, &attempt, &pid) < 0 || pid <= 0)
+            continue;
+        if (owner ? pid != owner : (kill(pid, 0) == 0 || errno != ESRCH))
+            continue;
+
+        queue_path(path, queue, "running", entry->d_name);
+        // a truncated name would no longer parse back: fail the job instead
+        int too_long = attempt < max_retries && snprintf(requeued, sizeof(requeued), "%s.%d", name, attempt + 1) >= (int)sizeof(requeued);
+        if (too_long) {
+            queue_path(target, queue, "failed", name);
+            atomic_fetch_add(&stats->jobs_failed, 1);
+            logging("job %s failed: its worker died and its name is too long to requeue", name);
+        } else if (attempt < max_retries) {
+            queue_path(target, queue, "pending", requeued);
+            atomic_fetch_add(&stats->retries, 1);
+            logging("job %s requeued after its worker %d died (retry %d of %d)", name, (int)pid, attempt + 1, max_retries);
+        } else {
+            queue_path(target, queue, "failed", name);
+            atomic_fetch_add(&stats->jobs_failed, 1);
+            logging("job %s failed: its worker died %d times", name, attempt + 1);
+        }
+        if (rename(path, target) < 0)
+            logging("could not move %s: %s", path, strerror(errno));
+    }
+    closedir(dir);
+}
+
+int supervisor_run(const char *queue, int nb_workers, int max_retries) {
+    if (queue_create(queue) < 0)
+        return -1;
+    SupervisorStats *stats = mmap(NULL, sizeof(*stats), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (stats == MAP_FAILED) {
+        logging("could not map the worker counters: %s", strerror(errno));
+        return -1;
+    }
+    atomic_init(&stats->jobs_done, 0);
+    atomic_init(&stats->jobs_failed, 0);
+    atomic_init(&stats->retries, 0);
+    atomic_init(&stats->frames, 0);
+
+    queue_requeue(queue, 0, max_retries, stats); // left behind by a previous supervisor
+
+    int64_t started = av_gettime_relative(), last_report = started;
+    int alive = 0, ret = 0;
+    for (;;) {
+        while (alive < nb_workers && queue_pending(queue) > 0) {
+            fflush(stdout);
+            fflush(stderr);
+            pid_t pid = fork();
+            if (pid == 0)
+                worker_main(queue, stats);
+            if (pid < 0) {
+                logging("could not start a worker: %s", strerror(errno));
+                break;
+            }
+            alive++;
+        }
+        if (alive == 0)
+            break;
+
+        int status;
+        pid_t pid = waitpid(-1, &status, WNOHANG);
+        if (pid < 0 && errno != EINTR) {
+            ret = -1;
+            break;
+        }
+        if (pid <= 0) {
+            struct timespec tick = { 0, 100 * 1000 * 1000 };
+            nanosleep(&tick, NULL);
+            governor_poll();
+            int64_t now = av_gettime_relative();
+            if (now - last_report >= PROGRESS_INTERVAL_US) {
+                last_report = now;
+                logging("%d workers, %ld jobs done, %d pending, %.1f frames/s", alive, atomic_load(&stats->jobs_done), queue_pending(queue),
+                        atomic_load(&stats->frames) / ((now - started) / 1e6));
+            }
+            continue;
+        }
+
+        alive--;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+            if (WIFSIGNALED(status))
+                logging("worker %d killed by signal %d", (int)pid, WTERMSIG(status));
+            else
+                logging("worker %d exited with status %d", (int)pid, WEXITSTATUS(status));
+            queue_requeue(queue, pid, max_retries, stats);
+        }
+    }
+
+    double seconds = (av_gettime_relative() - started) / 1e6;
+    long done = atomic_load(&stats->jobs_done), failed = atomic_load(&stats->jobs_failed), frames = atomic_load(&stats->frames);
+    printf("%ld jobs done, %ld failed, %ld retries, %ld frames in %.2f s: %.2f jobs/s, %.1f frames/s\n", done, failed,
+           atomic_load(&stats->retries), frames, seconds, seconds > 0 ? done / seconds : 0, seconds > 0 ? frames / seconds : 0);
+    munmap(stats, sizeof(*stats));
+    return ret < 0 ? -1 : failed > 0;
+}
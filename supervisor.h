@@ -0,0 +1,55 @@
+/**
+ * @file supervisor.h
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Node-local multi-process job coordinator. A supervisor forks worker
+ * processes that pull inputs from an on-disk queue, so a decoder crash on
+ * one bad file only costs the worker that hit it, not the batch.
+ *
+ * The queue is a directory of claim files:
+ *
+ *   <queue>/pending/<id>.<attempt>        input path, waiting for a worker
+ *   <queue>/running/<id>.<attempt>@<pid>  claimed by worker <pid>
+ *   <queue>/done/<id>                     input path and frame count
+ *   <queue>/failed/<id>                   failed, or crashed too many times
+ *   <queue>/out/<id>/frame-<n>.pgm/.ppm   extracted frames
+ *
+ * A worker claims a job by rename(2)-ing it from pending/ to running/, which
+ * only one of several racing workers can win. When a worker dies the
+ * supervisor moves its running job back to pending/ with the attempt
+ * incremented, or to failed/ once the retry limit is reached. Jobs left in
+ * running/ by a supervisor that was itself killed are recovered on the next
+ * start. Workers live as long as there is work and keep their frame buffers
+ * between jobs, like the threads of a pool.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef A3_SUPERVISOR_H
+#define A3_SUPERVISOR_H
+
+/**
+ * @brief
+ * Create the queue directories if needed and add one pending job per input
+ * @param queue queue directory
+ * @param inputs media files
+ * @param nb_inputs
+ * @return int 0 on success, -1 on failure
+ */
+int supervisor_enqueue(const char *queue, char *const *inputs, int nb_inputs);
+
+/**
+ * @brief
+ * Run workers until the queue is drained, then print aggregate throughput
+ * @param queue queue directory
+ * @param nb_workers worker processes kept alive while jobs are pending
+ * @param max_retries times a job is requeued after its worker died
+ * @return int 0 if every job is done, 1 if some failed, -1 on error
+ */
+int supervisor_run(const char *queue, int nb_workers, int max_retries);
+
+#endif
@@ -0,0 +1,128 @@
+/**
+ * @file thumbnail.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Best-thumbnail scoring, see thumbnail.h. The loops work on plain arrays
+ * with fixed-width integer types and no branches so that the compiler
+ * vectorizes them at -O3.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include <libavutil/pixdesc.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "thumbnail.h"
+
+#define THUMBNAIL_SCORE_WIDTH 256 // the luma plane is box-filtered down to at most this width
+
+/**
+ * @brief
+ * Box-filter plane by factor x factor into dst (width x height), 8 bit output
+ */
+static void downscale_luma(const AVFrame *frame, int depth, int factor, uint8_t *restrict dst, int width, int height) {
+    const int shift = depth - 8;
+    const int area = factor * factor;
+
+    for (int y = 0; y < height; y++) {
+        uint32_t sums[THUMBNAIL_SCORE_WIDTH] = { 0 };
+        for (int k = 0; k < factor; k++) {
+            const uint8_t *line = frame->data[0] + (y * factor + k) * frame->linesize[0];
+            if (depth == 8) {
+                const uint8_t *restrict src = line;
+                for (int x = 0; x < width; x++)
+                    for (int i = 0; i < factor; i++)
+                        sums[x] += src[x * factor + i];
+            } else {
+                const uint16_t *restrict src = (const uint16_t *)line;
+                for (int x = 0; x < width; x++)
+                    for (int i = 0; i < factor; i++)
+                        sums[x] += src[x * factor + i] >> shift;
+            }
+        }
+        for (int x = 0; x < width; x++)
+            dst[y * width + x] = (sums[x] + area / 2) / area;
+    }
+}
+
+/**
+ * @brief
+ * Variance of the 4-neighbour Laplacian over the interior pixels
+ */
+static double laplacian_variance(const uint8_t *restrict img, int width, int height) {
+    int64_t sum = 0, sum_squares = 0;
+
+    for (int y = 1; y < height - 1; y++) {
+        const uint8_t *up = img + (y - 1) * width, *row = img + y * width, *down = img + (y + 1) * width;
+        int32_t line_sum = 0;
+        int64_t line_squares = 0;
+        for (int x = 1; x < width - 1; x++) {
+            int32_t l = 4 * row[x] - row[x - 1] - row[x + 1] - up[x] - down[x];
+            line_sum += l;
+            line_squares += l * l;
+        }
+        sum += line_sum;
+        sum_squares += line_squares;
+    }
+
+    double n = (double)(width - 2) * (height - 2);
+    if (n <= 0)
+        return 0;
+    double mean = sum / n;
+    return sum_squares / n - mean * mean;
+}
+
+/**
+ * @brief
+ * Distance between the 5th and the 95th percentile of the luma histogram
+ */
+static double histogram_spread(const uint8_t *img, int count) {
+    uint32_t histogram[256] = { 0 };
+    for (int i = 0; i < count; i++)
+        histogram[img[i]]++;
+
+    int low = -1, high = 255;
+    uint32_t seen = 0;
+    for (int v = 0; v < 256; v++) {
+        seen += histogram[v];
+        if (low < 0 && seen * 20 >= (uint32_t)count)
+            low = v;
+        if (seen * 20 >= (uint32_t)count * 19) {
+            high = v;
+            break;
+        }
+    }
+    return low < 0 ? 0 : (high - low) / 255.0;
+}
+
+int thumbnail_score(const AVFrame *frame, FrameScore *score) {
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+    if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_RGB | AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BE)) ||
+        desc->comp[0].depth < 8 || desc->comp[0].depth > 16 || desc->comp[0].step != (desc->comp[0].depth + 7) / 8)
+        return -1; // no plain native-endian luma plane in data[0]
+
+    int factor = 1;
+    while (frame->width / factor > THUMBNAIL_SCORE_WIDTH)
+        factor *= 2;
+    int width = frame->width / factor, height = frame->height / factor;
+    if (width < 3 || height < 3)
+        return -1;
+
+    uint8_t *img = malloc((size_t)width * height);
+    if (!img)
+        return -1;
+    downscale_luma(frame, desc->comp[0].depth, factor, img, width, height);
+
+    score->sharpness = laplacian_variance(img, width, height);
+    score->spread = histogram_spread(img, width * height);
+    score->score = score->spread * log1p(score->sharpness);
+
+    free(img);
+    return 0;
+}
@@ -0,0 +1,37 @@
+/**
+ * @file thumbnail.h
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Best-thumbnail selection. Every decoded frame of a time window is scored
+ * on a downscaled copy of its luma plane, by sharpness (variance of the
+ * Laplacian) and exposure (spread of the luma histogram); only the best frame
+ * of each window is kept for conversion and writing.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef A3_THUMBNAIL_H
+#define A3_THUMBNAIL_H
+
+#include <libavutil/frame.h>
+
+typedef struct FrameScore {
+    double sharpness; // variance of the Laplacian of the downscaled luma
+    double spread;    // 5th to 95th percentile luma distance, 0..1; ~0 for black or flat frames
+    double score;     // spread * log(1 + sharpness), higher is better
+} FrameScore;
+
+/**
+ * @brief
+ * Score the luma plane of a frame
+ * @param frame planar YUV or gray frame, 8 to 16 bits
+ * @param score receives the scores
+ * @return int 0 on success, -1 if the format has no usable luma plane or out of memory
+ */
+int thumbnail_score(const AVFrame *frame, FrameScore *score);
+
+#endif
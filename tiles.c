@@ -0,0 +1,246 @@
+/**
+ * @file tiles.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Tile pyramids, see tiles.h.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <libavutil/common.h>
+
+#include "downscale.h"
+#include "slice.h"
+#include "tiles.h"
+
+/**
+ * @brief
+ * One level of the pyramid, packed RGB24
+ */
+typedef struct Level {
+    uint8_t *data;
+    int linesize;
+    int width;
+    int height;
+} Level;
+
+/**
+ * @brief
+ * The tiles of one level, written in parallel: slice_run() band i is tile i
+ */
+typedef struct LevelTiles {
+    const Level *level;
+    TileLayout layout;
+    const char *base;      // <prefix>-<n>_files (DZI) or <prefix>-<n> (XYZ)
+    int number;            // DZI level or XYZ zoom
+    int columns;
+    const char *extension; // of the tiles
+    TileWriter write_tile;
+    atomic_int failed;     // set by any tile that could not be written
+} LevelTiles;
+
+typedef struct HalveBands {
+    const Level *src;
+    Level *dst;
+} HalveBands;
+
+static const char *const layout_names[] = { "none", "dzi", "xyz" };
+
+int tile_layout_parse(const char *name, TileLayout *layout) {
+    for (int i = TILE_LAYOUT_DZI; i <= TILE_LAYOUT_XYZ; i++) {
+        if (!strcmp(name, layout_names[i])) {
+            *layout = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *tile_layout_extension(TileLayout layout) {
+    return layout == TILE_LAYOUT_DZI ? "dzi" : "json";
+}
+
+/**
+ * @brief
+ * snprintf() of an output path that fails rather than truncate it: a cut
+ * path would put the tiles in another directory
+ * @return int 0, -1 if the path does not fit
+ */
+static int format_path(char *path, size_t size, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(path, size, format, args);
+    va_end(args);
+    if (len < 0 || (size_t)len >= size) {
+        fprintf(stderr, "output path too long: %s...\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+static int make_dir(const char *path) {
+    if (mkdir(path, 0755) < 0 && errno != EEXIST) {
+        fprintf(stderr, "could not create %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief
+ * Number of 2x reductions until neither side is larger than limit
+ */
+static int count_halvings(int size, int limit) {
+    int n = 0;
+    for (; size > limit; n++)
+        size = downscale_size(size, 2);
+    return n;
+}
+
+static void write_tile_band(void *arg, int tile, int nb_tiles) {
+    LevelTiles *tiles = arg;
+    const Level *level = tiles->level;
+    int column = tile % tiles->columns, row = tile / tiles->columns;
+    int x = column * TILE_SIZE, y = row * TILE_SIZE;
+    char filename[1024];
+    (void)nb_tiles;
+
+    int ret;
+    if (tiles->layout == TILE_LAYOUT_DZI)
+        ret = format_path(filename, sizeof(filename), "%s/%d/%d_%d.%s", tiles->base, tiles->number, column, row, tiles->extension);
+    else
+        ret = format_path(filename, sizeof(filename), "%s/%d/%d/%d.%s", tiles->base, tiles->number, column, row, tiles->extension);
+    if (ret < 0 || tiles->write_tile(level->data + (ptrdiff_t)y * level->linesize + x * 3, level->linesize,
+                          FFMIN(TILE_SIZE, level->width - x), FFMIN(TILE_SIZE, level->height - y), filename) < 0)
+        atomic_store(&tiles->failed, 1);
+}
+
+/**
+ * @brief
+ * Create the directories of one level, then write its tiles on the pool
+ */
+static int write_level(LevelTiles *tiles) {
+    const Level *level = tiles->level;
+    int columns = (level->width + TILE_SIZE - 1) / TILE_SIZE, rows = (level->height + TILE_SIZE - 1) / TILE_SIZE;
+    char path[1024];
+
+    if (format_path(path, sizeof(path), "%s/%d", tiles->base, tiles->number) < 0 || make_dir(path) < 0)
+        return -1;
+    for (int column = 0; tiles->layout == TILE_LAYOUT_XYZ && column < columns; column++) {
+        if (format_path(path, sizeof(path), "%s/%d/%d", tiles->base, tiles->number, column) < 0 || make_dir(path) < 0)
+            return -1;
+    }
+
+    tiles->columns = columns;
+    atomic_store(&tiles->failed, 0);
+    slice_run(write_tile_band, tiles, columns * rows);
+    return atomic_load(&tiles->failed) ? -1 : 0;
+}
+
+static void halve_band(void *arg, int band, int nb_bands) {
+    const HalveBands *bands = arg;
+    const Level *src = bands->src;
+    Level *dst = bands->dst;
+    int rows = (dst->height + nb_bands - 1) / nb_bands;
+    int y0 = band * rows, y1 = FFMIN(dst->height, y0 + rows);
+
+    for (int y = y0; y < y1; y++)
+        downscale_half_rgb_row(src->data + (ptrdiff_t)2 * y * src->linesize, src->linesize, src->width,
+                               FFMIN(2, src->height - 2 * y), dst->data + (ptrdiff_t)y * dst->linesize);
+}
+
+/**
+ * @brief
+ * dst = src halved, in bands on the pool; dst->data must be allocated
+ */
+static void halve_level(const Level *src, Level *dst) {
+    HalveBands bands = { src, dst };
+    dst->width = downscale_size(src->width, 2);
+    dst->height = downscale_size(src->height, 2);
+    dst->linesize = dst->width * 3;
+    slice_run(halve_band, &bands, slice_auto_bands(src->width, src->height));
+}
+
+static int write_descriptor(const AVFrame *frame_rgb, const char *prefix, int fnumber, TileLayout layout,
+                            const char *base, int top, const char *tile_extension) {
+    char filename[1024];
+    if (format_path(filename, sizeof(filename), "%s-%d.%s", prefix, fnumber, tile_layout_extension(layout)) < 0)
+        return -1;
+    FILE *f = fopen(filename, "w");
+    if (!f) {
+        fprintf(stderr, "could not create %s: %s\n", filename, strerror(errno));
+        return -1;
+    }
+
+    if (layout == TILE_LAYOUT_DZI) {
+        fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                   "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" Format=\"%s\" Overlap=\"0\" TileSize=\"%d\">\n"
+                   "  <Size Width=\"%d\" Height=\"%d\"/>\n"
+                   "</Image>\n",
+                tile_extension, TILE_SIZE, frame_rgb->width, frame_rgb->height);
+    } else {
+        // tile URLs relative to the descriptor, which sits next to the tile directory
+        const char *name = strrchr(base, '/') ? strrchr(base, '/') + 1 : base;
+        fprintf(f, "{\"width\": %d, \"height\": %d, \"tile_size\": %d, \"min_zoom\": 0, \"max_zoom\": %d, "
+                   "\"format\": \"%s\", \"tiles\": \"%s/{z}/{x}/{y}.%s\"}\n",
+                frame_rgb->width, frame_rgb->height, TILE_SIZE, top, tile_extension, name, tile_extension);
+    }
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+int tiles_write_pyramid(const AVFrame *frame_rgb, const char *prefix, int fnumber, TileLayout layout,
+                        const char *tile_extension, TileWriter write_tile) {
+    char base[1024];
+    if (format_path(base, sizeof(base), "%s-%d%s", prefix, fnumber, layout == TILE_LAYOUT_DZI ? "_files" : "") < 0 || make_dir(base) < 0)
+        return -1;
+
+    // DZI goes down to 1x1, XYZ stops at the first level that fits in one tile
+    int top = count_halvings(FFMAX(frame_rgb->width, frame_rgb->height), layout == TILE_LAYOUT_DZI ? 1 : TILE_SIZE);
+
+    // the levels below the frame alternate between two buffers, the first one sized for the largest
+    uint8_t *buffers[2] = { NULL, NULL };
+    for (int i = 0; i < 2 && i < top; i++) {
+        int factor = 2 << i;
+        buffers[i] = malloc((size_t)downscale_size(frame_rgb->width, factor) * 3 * downscale_size(frame_rgb->height, factor));
+        if (!buffers[i]) {
+            fprintf(stderr, "could not allocate the pyramid of frame %d\n", fnumber);
+            free(buffers[0]);
+            return -1;
+        }
+    }
+
+    Level level = { frame_rgb->data[0], frame_rgb->linesize[0], frame_rgb->width, frame_rgb->height };
+    LevelTiles tiles = { .level = &level, .layout = layout, .base = base, .extension = tile_extension, .write_tile = write_tile };
+    int ret = 0;
+    for (int number = top; number >= 0; number--) {
+        tiles.number = number;
+        if (write_level(&tiles) < 0) {
+            ret = -1;
+            break;
+        }
+        if (number > 0) {
+            Level next = { .data = buffers[(top - number) & 1] };
+            halve_level(&level, &next);
+            level = next;
+        }
+    }
+    free(buffers[0]);
+    free(buffers[1]);
+
+    // written last, so a viewer never finds a descriptor without its tiles
+    if (ret == 0)
+        ret = write_descriptor(frame_rgb, prefix, fnumber, layout, base, top, tile_extension);
+    return ret;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file tiles.h
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Deep-zoom tile pyramids of converted frames, for viewers that pan and zoom
+ * into high resolution images. The full size RGB frame is the top level;
+ * every lower level is the previous one halved with a 2x2 box filter
+ * (downscale.h), never re-scaled from full size. Each level is cut into
+ * TILE_SIZE x TILE_SIZE tiles, smaller on the right and bottom edges, and
+ * the tiles are written in parallel on the slice pool (slice.h), in the
+ * image format of the RGB writer.
+ *
+ * Two layouts, for frame <prefix>-<n>:
+ *
+ *   DZI  <prefix>-<n>.dzi                     Deep Zoom descriptor (XML)
+ *        <prefix>-<n>_files/<level>/<col>_<row>.<ext>
+ *        level 0 is 1x1, the last level is the full frame
+ *
+ *   XYZ  <prefix>-<n>.json                    size, tile size, zoom range
+ *        <prefix>-<n>/<z>/<x>/<y>.<ext>
+ *        zoom 0 is the first level that fits in one tile
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef A3_TILES_H
+#define A3_TILES_H
+
+#include <stdint.h>
+
+#include <libavutil/frame.h>
+
+#define TILE_SIZE 256
+
+typedef enum TileLayout {
+    TILE_LAYOUT_NONE, // plain images, the default
+    TILE_LAYOUT_DZI,
+    TILE_LAYOUT_XYZ,
+} TileLayout;
+
+/**
+ * @brief
+ * Writes one tile; called from several threads at once
+ * @param rgb first pixel of the tile, packed RGB24
+ * @param linesize of the level the tile is cut from
+ * @param width
+ * @param height
+ * @param filename
+ * @return int 0 on success, a negative value on failure
+ */
+typedef int (*TileWriter)(const uint8_t *rgb, int linesize, int width, int height, const char *filename);
+
+/**
+ * @brief
+ * Parse "dzi" or "xyz"
+ * @param name
+ * @param layout
+ * @return int 0 on success, -1 if unknown
+ */
+int tile_layout_parse(const char *name, TileLayout *layout);
+
+/**
+ * @brief
+ * Extension of the file describing a pyramid: "dzi" or "json"
+ * @param layout
+ * @return const char*
+ */
+const char *tile_layout_extension(TileLayout layout);
+
+/**
+ * @brief
+ * Build and write every level of the pyramid of one frame
+ * @param frame_rgb full size RGB24 frame
+ * @param prefix
+ * @param fnumber
+ * @param layout DZI or XYZ
+ * @param tile_extension file extension of the tiles, without the dot
+ * @param write_tile
+ * @return int 0 on success, -1 on failure
+ */
+int tiles_write_pyramid(const AVFrame *frame_rgb, const char *prefix, int fnumber, TileLayout layout,
+                        const char *tile_extension, TileWriter write_tile);
+
+#endif
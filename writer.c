@@ -0,0 +1,339 @@
+/**
+ * @file writer.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief 
+ * 
+ * Image writers, see writer.h.
+ * 
+ * @version 0.1
+ * @date 2022-10-06
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#include <libavutil/imgutils.h>
+#include <libswscale/swscale.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "convert.h"
+#include "downscale.h"
+#include "outfile.h"
+#include "qoi.h"
+#include "slice.h"
+#include "tiles.h"
+#include "writer.h"
+
+/** room left after the pixels of a converted image: swscale may store a whole vector at the end of a row */
+#define RGB_TAIL_SLACK 64
+
+static enum AVPixelFormat dst_pix_fmt = AV_PIX_FMT_RGB24;
+static int gray_factor = 1;
+
+void writer_set_gray_factor(int factor) {
+    gray_factor = factor;
+}
+
+/**
+ * @brief
+ * Create a PNM file (outfile.h) and write its header
+ * @param file
+ * @param filename
+ * @param magic "P5" (gray) or "P6" (RGB)
+ * @param width
+ * @param height
+ * @param bytes_per_pixel
+ * @param slack extra bytes past the pixels the caller may scribble on, not written out
+ * @return uint8_t* first pixel row, NULL on failure (errno is set); close with close_output(file, file->size - slack)
+ */
+static uint8_t *open_pnm(OutFile *file, const char *filename, const char *magic, int width, int height, int bytes_per_pixel, size_t slack) {
+    // portable anymap format -> https://en.wikipedia.org/wiki/Netpbm_format#PGM_example
+    char header[64];
+    int header_size = snprintf(header, sizeof(header), "%s\n%d %d\n%d\n", magic, width, height, 255);
+    if (outfile_open(file, filename, header_size + (size_t)width * height * bytes_per_pixel + slack) < 0) {
+        int err = errno;
+        fprintf(stderr, "could not create %s: %s\n", filename, strerror(err));
+        errno = err;
+        return NULL;
+    }
+    memcpy(file->data, header, header_size);
+    return file->data + header_size;
+}
+
+/**
+ * @brief
+ * outfile_close(), logging a failure
+ * @return int 0 on success, a negative AVERROR on failure
+ */
+static int close_output(OutFile *file, size_t size) {
+    if (outfile_close(file, size) < 0) {
+        int err = errno;
+        fprintf(stderr, "could not write %s: %s\n", file->filename, strerror(err));
+        return AVERROR(err);
+    }
+    return 0;
+}
+
+/**
+ * @brief
+ * Write the luma reduced by gray_factor: every output row is box filtered
+ * from the decoded plane (downscale.c) straight into the output file
+ */
+static int save_gray_downscaled(const unsigned char *buf, int wrap, int xsize, int ysize, const char *filename) {
+    int out_width = downscale_size(xsize, gray_factor), out_height = downscale_size(ysize, gray_factor);
+    uint16_t *sums = malloc(xsize * sizeof(*sums));
+    OutFile file;
+    if (!sums)
+        return AVERROR(ENOMEM);
+    uint8_t *pixels = open_pnm(&file, filename, "P5", out_width, out_height, 1, 0);
+    if (!pixels) {
+        int ret = AVERROR(errno);
+        free(sums);
+        return ret;
+    }
+    for (int y = 0; y < ysize; y += gray_factor)
+        downscale_box_row(buf + (ptrdiff_t)y * wrap, wrap, xsize, FFMIN(gray_factor, ysize - y), gray_factor, sums,
+                          pixels + (ptrdiff_t)(y / gray_factor) * out_width);
+    free(sums);
+    return close_output(&file, file.size);
+}
+
+//convert to rgba (contextWidth, contextHeight,)
+
+/**
+ * @brief 
+ * Function to save the frame as a grayscale
+ * @param buf 
+ * @param wrap 
+ * @param xsize 
+ * @param ysize 
+ * @param prefix 
+ * @param fnumber 
+ * @return int 0 on success, a negative AVERROR on failure
+ */
+int save_gray_frame(unsigned char *buf,  int wrap, int xsize, int ysize, const char *prefix, int fnumber) {
+    char frame_filename[1024];
+    snprintf(frame_filename, sizeof(frame_filename), "%s-%d.pgm", prefix, fnumber);
+    char *filename = frame_filename;
+    OutFile file;
+    uint8_t *pixels;
+    int i;
+    if (gray_factor > 1)
+        return save_gray_downscaled(buf, wrap, xsize, ysize, filename);
+    // writing the minimal required header for a pgm file format
+    pixels = open_pnm(&file, filename, "P5", xsize, ysize, 1, 0);
+    if (!pixels)
+        return AVERROR(errno);
+
+    // writing line by line
+    for (i = 0; i < ysize; i++)
+        memcpy(pixels + (size_t)i * xsize, buf + i * wrap, xsize);
+    return close_output(&file, file.size);
+}
+
+
+static RgbFormat rgb_format = RGB_FORMAT_PPM;
+static TileLayout tile_layout = TILE_LAYOUT_NONE;
+
+static const char *const rgb_format_names[] = { "ppm", "qoi" };
+
+int rgb_format_parse(const char *name, RgbFormat *format) {
+    for (int i = 0; i < (int)(sizeof(rgb_format_names) / sizeof(rgb_format_names[0])); i++) {
+        if (!strcmp(name, rgb_format_names[i])) {
+            *format = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void writer_set_rgb_format(RgbFormat format) {
+    rgb_format = format;
+}
+
+void writer_set_tile_layout(TileLayout layout) {
+    tile_layout = layout;
+}
+
+const char *writer_rgb_extension(void) {
+    return tile_layout != TILE_LAYOUT_NONE ? tile_layout_extension(tile_layout) : rgb_format_names[rgb_format];
+}
+
+/**
+ * @brief
+ * Size and orientation of the RGB image of a decoded frame: square pixels, upright
+ * @param pFrame
+ * @param geometry
+ * @return int 1 if a kernel of convert.c does the conversion, 0 for swscale
+ */
+static int rgb_geometry(const AVFrame *pFrame, FrameGeometry *geometry) {
+    frame_geometry(pFrame, geometry);
+    int has_kernel = converter_find(pFrame->format, dst_pix_fmt) != NULL;
+    if (!has_kernel && geometry->rotation != 0) {
+        // swscale only resizes: keep the source orientation
+        geometry->rotation = 0;
+        geometry->width = geometry->scaled_width;
+        geometry->height = pFrame->height;
+    }
+    return has_kernel;
+}
+
+/**
+ * @brief
+ * Convert a decoded frame into an RGB24 frame of the size rgb_geometry() returned:
+ * anamorphic and rotated sources are corrected in the conversion pass
+ * @return int 0 on success, a negative AVERROR on failure
+ */
+static int convert_into(AVFrame *pFrame, AVFrame *frame_rgb, const FrameGeometry *geometry, int has_kernel, int fnumber) {
+    // source(src)=> pFrame  & destination(dst) => frame_rgb
+    // refer: https://ffmpeg.org/doxygen/3.1/scaling_video_8c-example.html
+    // use swscale for conversion  ->  sws_ctx = sws_getContext(src_w, src_h, src_pix_fmt, dst_w, dst_h, dst_pix_fmt, SWS_BILINEAR, NULL, NULL, NULL);
+    // the common decoder outputs have a specialized kernel (convert.c), anything else goes through swscale
+    // large frames are converted in bands on a thread pool (slice.c) to cut the per-frame latency
+    if (has_kernel) {
+        if (geometry->rotation == 0 && geometry->scaled_width == pFrame->width)
+            slice_convert_frame(pFrame, frame_rgb, 0);
+        else if (convert_frame_geometry(pFrame, frame_rgb, geometry) < 0) {
+            fprintf(stderr, "could not convert frame %d\n", fnumber);
+            return AVERROR(EINVAL);
+        }
+    } else if (frame_rgb->width != pFrame->width || slice_scale_frame(pFrame, frame_rgb, 0, SWS_FAST_BILINEAR | SWS_FULL_CHR_H_INT | SWS_ACCURATE_RND) < 0) {
+        // resizing swscale runs on the whole frame: its vertical filter spans band edges
+        struct SwsContext* converted_data = sws_getContext(pFrame->width, pFrame->height, pFrame->format, frame_rgb->width,frame_rgb->height, dst_pix_fmt, SWS_FAST_BILINEAR | SWS_FULL_CHR_H_INT | SWS_ACCURATE_RND, NULL, NULL, NULL);
+        if (!converted_data) {
+            fprintf(stderr, "could not convert frame %d\n", fnumber);
+            return AVERROR(EINVAL);
+        }
+        sws_scale(converted_data,(uint8_t const * const *)pFrame->data, pFrame->linesize, 0, pFrame->height, frame_rgb->data, frame_rgb->linesize);
+        sws_freeContext(converted_data);
+    }
+    return 0;
+}
+
+/**
+ * @brief
+ * Convert a decoded frame to RGB24, see convert_into()
+ * @param pFrame
+ * @param fnumber for error messages
+ * @return AVFrame* allocated with allocateFrame(), free with free_rgb_frame(); NULL on failure
+ */
+static AVFrame *convert_to_rgb(AVFrame *pFrame, int fnumber) {
+    FrameGeometry geometry;
+    int has_kernel = rgb_geometry(pFrame, &geometry);
+
+    // create scaling to convert to rgb
+    AVFrame* frame_rgb = allocateFrame(geometry.width, geometry.height);
+    if (convert_into(pFrame, frame_rgb, &geometry, has_kernel, fnumber) < 0) {
+        av_freep(&frame_rgb->data[0]);
+        av_frame_free(&frame_rgb);
+    }
+    return frame_rgb;
+}
+
+static void free_rgb_frame(AVFrame *frame_rgb) {
+    av_freep(&frame_rgb->data[0]); // allocated by av_image_alloc() in allocateFrame()
+    av_frame_free(&frame_rgb);
+}
+
+static int save_ppm(const uint8_t *rgb, int linesize, int width, int height, const char *filename) {
+    OutFile file;
+    int i;
+    // write header
+    uint8_t *pixels = open_pnm(&file, filename, "P6", width, height, 3, 0);
+    if (!pixels)
+        return AVERROR(errno);
+    for (i = 0; i < height; i++) 
+        memcpy(pixels + (size_t)i * width * 3, rgb + i * linesize, width * 3);
+    return close_output(&file, file.size);
+}
+
+static int save_qoi(const uint8_t *rgb, int linesize, int width, int height, const char *filename) {
+    // encoded in place into room for the worst case, the file is cut to the real size
+    OutFile file;
+    if (outfile_open(&file, filename, qoi_max_size(width, height)) < 0) {
+        int err = errno;
+        fprintf(stderr, "could not create %s: %s\n", filename, strerror(err));
+        return AVERROR(err);
+    }
+    return close_output(&file, qoi_encode_rgb(rgb, linesize, width, height, file.data));
+}
+
+/**
+ * @brief
+ * Convert a frame straight into the pixels of a PPM file: no intermediate RGB frame
+ */
+static int convert_to_ppm(AVFrame *pFrame, int fnumber, const char *filename) {
+    FrameGeometry geometry;
+    int has_kernel = rgb_geometry(pFrame, &geometry);
+    OutFile file;
+    AVFrame *frame_rgb = av_frame_alloc();
+    if (!frame_rgb)
+        return AVERROR(ENOMEM);
+    uint8_t *pixels = open_pnm(&file, filename, "P6", geometry.width, geometry.height, 3, RGB_TAIL_SLACK);
+    if (!pixels) {
+        av_frame_free(&frame_rgb);
+        return AVERROR(errno);
+    }
+    // a frame over the file content, packed rows as in the file
+    frame_rgb->data[0] = pixels;
+    frame_rgb->linesize[0] = geometry.width * 3;
+    frame_rgb->width = geometry.width;
+    frame_rgb->height = geometry.height;
+    frame_rgb->format = dst_pix_fmt;
+    int ret = convert_into(pFrame, frame_rgb, &geometry, has_kernel, fnumber);
+    av_frame_free(&frame_rgb); // does not own data[0]
+    int closed = close_output(&file, file.size - RGB_TAIL_SLACK);
+    return ret < 0 ? ret : closed;
+}
+
+/**
+ * @brief
+ * Write an RGB24 image in the selected format; also the TileWriter of the pyramids
+ */
+static int save_rgb_image(const uint8_t *rgb, int linesize, int width, int height, const char *filename) {
+    if (rgb_format == RGB_FORMAT_QOI)
+        return save_qoi(rgb, linesize, width, height, filename);
+    return save_ppm(rgb, linesize, width, height, filename);
+}
+
+int save_rgb_frame(AVFrame *pFrame, const char *prefix, int fnumber) {
+    char frame_filename[1024];
+    snprintf(frame_filename, sizeof(frame_filename), "%s-%d.%s", prefix, fnumber, writer_rgb_extension());
+
+    if (tile_layout == TILE_LAYOUT_NONE && rgb_format == RGB_FORMAT_PPM)
+        return convert_to_ppm(pFrame, fnumber, frame_filename);
+    AVFrame *frame_rgb = convert_to_rgb(pFrame, fnumber);
+    if (!frame_rgb)
+        return AVERROR(EINVAL);
+    int ret;
+    if (tile_layout != TILE_LAYOUT_NONE) {
+        ret = tiles_write_pyramid(frame_rgb, prefix, fnumber, tile_layout, rgb_format_names[rgb_format], save_rgb_image);
+        if (ret < 0) {
+            fprintf(stderr, "could not write the tile pyramid of frame %d\n", fnumber);
+            ret = AVERROR(EIO);
+        }
+    } else {
+        ret = save_rgb_image(frame_rgb->data[0], frame_rgb->linesize[0], frame_rgb->width, frame_rgb->height, frame_filename);
+    }
+    free_rgb_frame(frame_rgb);
+    return ret;
+}
+
+AVFrame* allocateFrame(int width, int height){
+
+    AVFrame* newFrame = av_frame_alloc();
+    if (newFrame == NULL)
+        fprintf(stderr, "could not allocate destination frame");
+  
+    if (av_image_alloc(newFrame->data, newFrame->linesize, width, height, dst_pix_fmt, 1) < 0) 
+        fprintf(stderr, "Could not allocate destination image");
+  
+    newFrame->width = width;
+    newFrame->height = height;
+    newFrame->format = dst_pix_fmt;
+
+    return newFrame;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file writer.h
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief 
+ * 
+ * Image writers: save decoded frames as .pgm (luma) and .ppm (RGB24) files
+ * named <prefix>-<number>, the command line uses the prefix "frame". The RGB
+ * image can be written as lossless QOI (qoi.h) instead of PPM, or as a deep
+ * zoom tile pyramid (tiles.h), and the luma image reduced 2, 4 or 8 times.
+ * 
+ * @version 0.1
+ * @date 2022-10-06
+ * 
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef A3_WRITER_H
+#define A3_WRITER_H
+
+#include <libavutil/frame.h>
+
+#include "tiles.h"
+
+typedef enum RgbFormat {
+    RGB_FORMAT_PPM, // uncompressed, the default
+    RGB_FORMAT_QOI, // lossless, a few times smaller
+} RgbFormat;
+
+/**
+ * @brief
+ * Parse "ppm" or "qoi"
+ * @param name
+ * @param format
+ * @return int 0 on success, -1 if unknown
+ */
+int rgb_format_parse(const char *name, RgbFormat *format);
+
+/**
+ * @brief
+ * Select the file format of save_rgb_frame(), before any frame is written
+ * @param format
+ */
+void writer_set_rgb_format(RgbFormat format);
+
+/**
+ * @brief
+ * Write every RGB frame as a tile pyramid (tiles.h) in that layout instead of
+ * one image, TILE_LAYOUT_NONE for plain images; set before any frame is written
+ * @param layout
+ */
+void writer_set_tile_layout(TileLayout layout);
+
+/**
+ * @brief
+ * File extension of the selected RGB format, without the dot, or of the
+ * pyramid descriptor when tiles are written
+ */
+const char *writer_rgb_extension(void);
+
+/**
+ * @brief 
+ * Reduce the .pgm images of save_gray_frame() by 2, 4 or 8 with a box filter
+ * (downscale.h), 1 for full size; set before any frame is written
+ * @param factor
+ */
+void writer_set_gray_factor(int factor);
+
+/**
+ * @brief 
+ * Function to convert frame into grayscale and save
+ * @param buf 
+ * @param wrap 
+ * @param xsize 
+ * @param ysize 
+ * @param prefix 
+ * @param fnumber 
+ * @return int 0 on success, a negative AVERROR on failure
+ */
+int save_gray_frame(unsigned char *buf, int wrap, int xsize, int ysize, const char *prefix, int fnumber);
+
+/**
+ * @brief 
+ * Function to convert frame into RGB24 and save, as .ppm or .qoi
+ * @param frame 
+ * @param prefix 
+ * @param fnumber 
+ * @return int 0 on success, a negative AVERROR on failure
+ */
+int save_rgb_frame(AVFrame *frame, const char *prefix, int fnumber);
+
+/**
+ * @brief 
+ * Function to allocate an RGB24 destination frame
+ * @param width 
+ * @param height 
+ * @return AVFrame* 
+ */
+AVFrame* allocateFrame(int width, int height);
+
+#endif
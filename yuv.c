@@ -0,0 +1,182 @@
+/**
+ * @file yuv.c
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Raw planar output, see yuv.h.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <libavutil/common.h>
+#include <libavutil/error.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+
+#include "extract.h"
+#include "governor.h"
+#include "outfile.h"
+#include "yuv.h"
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+/**
+ * @brief
+ * One iovec per plane row, or per plane when its rows have no padding
+ * @param frame
+ * @param iov receives the vectors, NULL to only count them
+ * @param bytes receives the total size
+ * @return int number of vectors, <0 AVERROR if the format has no raw planes
+ */
+static int frame_iovecs(const AVFrame *frame, struct iovec *iov, size_t *bytes) {
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+    if (!desc || desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL))
+        return AVERROR(ENOSYS);
+
+    int n = 0, nb_planes = av_pix_fmt_count_planes(frame->format);
+    *bytes = 0;
+    for (int plane = 0; plane < nb_planes; plane++) {
+        int row_bytes = av_image_get_linesize(frame->format, frame->width, plane);
+        int rows = plane == 1 || plane == 2 ? AV_CEIL_RSHIFT(frame->height, desc->log2_chroma_h) : frame->height;
+        if (row_bytes <= 0)
+            return AVERROR(EINVAL);
+
+        if (frame->linesize[plane] == row_bytes) {
+            if (iov)
+                iov[n] = (struct iovec){ frame->data[plane], (size_t)row_bytes * rows };
+            n++;
+        } else {
+            for (int y = 0; y < rows; y++, n++) {
+                if (iov)
+                    iov[n] = (struct iovec){ frame->data[plane] + (ptrdiff_t)y * frame->linesize[plane], row_bytes };
+            }
+        }
+        *bytes += (size_t)row_bytes * rows;
+    }
+    return n;
+}
+
+/**
+ * @brief
+ * Write all the vectors at offset (or the file position when offset < 0),
+ * in batches of IOV_MAX and resuming after short writes
+ */
+static int write_iovecs(int fd, struct iovec *iov, int n, off_t offset) {
+    while (n > 0) {
+        int batch = n < IOV_MAX ? n : IOV_MAX;
+        ssize_t written = offset < 0 ? writev(fd, iov, batch) : pwritev(fd, iov, batch, offset);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return AVERROR(errno);
+        }
+        if (offset >= 0)
+            offset += written;
+        for (; n > 0 && (size_t)written >= iov->iov_len; iov++, n--)
+            written -= iov->iov_len;
+        if (n > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief
+ * Gather the planes of frame and write them to fd
+ */
+static int write_frame(int fd, const AVFrame *frame, off_t offset, size_t *bytes) {
+    int n = frame_iovecs(frame, NULL, bytes);
+    if (n < 0)
+        return n;
+    struct iovec *iov = malloc(n * sizeof(*iov));
+    if (!iov)
+        return AVERROR(ENOMEM);
+    frame_iovecs(frame, iov, bytes);
+    governor_write(*bytes);
+    int ret = write_iovecs(fd, iov, n, offset);
+    // --write-mode direct|dontneed: keep the planes out of the page cache (a new file starts at 0)
+    if (ret == 0 && outfile_release(fd, FFMAX(offset, 0), *bytes) < 0)
+        ret = AVERROR(errno);
+    free(iov);
+    return ret;
+}
+
+int save_yuv_frame(const AVFrame *frame, const char *prefix, int fnumber) {
+    char filename[1024];
+    size_t bytes;
+    snprintf(filename, sizeof(filename), "%s-%d.yuv", prefix, fnumber);
+
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        logging("could not open %s: %s", filename, strerror(errno));
+        return AVERROR(errno);
+    }
+    int ret = write_frame(fd, frame, -1, &bytes);
+    if (close(fd) < 0 && ret == 0)
+        ret = AVERROR(errno);
+    if (ret < 0)
+        logging("could not write %s: %s", filename, av_err2str(ret));
+    return ret;
+}
+
+int yuv_stream_open(YuvStream *stream, const char *path) {
+    char index_path[1024];
+    snprintf(index_path, sizeof(index_path), "%s.idx", path);
+
+    stream->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    stream->index = stream->fd >= 0 ? fopen(index_path, "w") : NULL;
+    if (!stream->index) {
+        int ret = AVERROR(errno);
+        logging("could not create %s and %s: %s", path, index_path, strerror(errno));
+        if (stream->fd >= 0)
+            close(stream->fd);
+        return ret;
+    }
+    atomic_init(&stream->offset, 0);
+    fprintf(stream->index, "# frame offset bytes width height pix_fmt pts\n");
+    return 0;
+}
+
+int yuv_stream_write(YuvStream *stream, const AVFrame *frame, int fnumber) {
+    size_t bytes;
+    if (frame_iovecs(frame, NULL, &bytes) < 0) {
+        logging("frame %d: %s has no raw planes", fnumber, av_get_pix_fmt_name(frame->format));
+        return AVERROR(ENOSYS);
+    }
+
+    // reserve the range first, so writers never wait for each other
+    long long offset = atomic_fetch_add(&stream->offset, (long long)bytes);
+    int ret = write_frame(stream->fd, frame, offset, &bytes);
+    if (ret < 0) {
+        logging("frame %d: %s", fnumber, av_err2str(ret));
+        return ret;
+    }
+    fprintf(stream->index, "%d %lld %zu %d %d %s %" PRId64 "\n", fnumber, offset, bytes, frame->width, frame->height,
+            av_get_pix_fmt_name(frame->format), frame->best_effort_timestamp);
+    return 0;
+}
+
+int yuv_stream_close(YuvStream *stream) {
+    int ret = 0;
+    if (fclose(stream->index) != 0)
+        ret = AVERROR(errno);
+    if (close(stream->fd) < 0)
+        ret = AVERROR(errno);
+    return ret;
+}
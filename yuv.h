@@ -0,0 +1,73 @@
+/**
+ * @file yuv.h
+ * @author Emmanuel Ainoo & Elijah Ayomide Oduba
+ * @brief
+ *
+ * Raw output of the decoded planes, for tools that want the YUV samples the
+ * decoder produced rather than RGB. The planes are written as they are, one
+ * after the other (Y, U, V, then alpha if any), rows packed without padding,
+ * in the frame's own pixel format: no swscale, no conversion. Every plane
+ * row is one iovec of a single writev(2) per frame.
+ *
+ * A YuvStream appends all the frames to one .yuv file and lists them in a
+ * text index next to it, <path>.idx:
+ *
+ *   # frame offset bytes width height pix_fmt pts
+ *   1 0 3110400 1920 1080 yuv420p 0
+ *   ...
+ *
+ * Frames written from several threads land in completion order; the index
+ * gives each one's offset.
+ *
+ * @version 0.1
+ * @date 2022-10-06
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef A3_YUV_H
+#define A3_YUV_H
+
+#include <stdatomic.h>
+#include <stdio.h>
+
+#include <libavutil/frame.h>
+
+typedef struct YuvStream {
+    int fd;
+    FILE *index;
+    atomic_llong offset; // end of the data reserved so far
+} YuvStream;
+
+/**
+ * @brief
+ * Write the planes of frame to <prefix>-<fnumber>.yuv
+ * @param frame decoded frame in a software pixel format without palette
+ * @param prefix
+ * @param fnumber
+ * @return int 0 on success, <0 AVERROR on failure
+ */
+int save_yuv_frame(const AVFrame *frame, const char *prefix, int fnumber);
+
+/**
+ * @brief
+ * Create path and its index path.idx
+ * @return int 0 on success, <0 AVERROR on failure
+ */
+int yuv_stream_open(YuvStream *stream, const char *path);
+
+/**
+ * @brief
+ * Append the planes of frame and its index line; safe to call from several threads
+ * @return int 0 on success, <0 AVERROR on failure
+ */
+int yuv_stream_write(YuvStream *stream, const AVFrame *frame, int fnumber);
+
+/**
+ * @brief
+ * Close the file and the index
+ * @return int 0 on success, <0 AVERROR if data could not be flushed
+ */
+int yuv_stream_close(YuvStream *stream);
+
+#endif